@@ -1,4 +1,37 @@
 #include <iostream>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+/**
+ * 统计全局分配次数：替换全局operator new/delete，仅用于基准测试中计算每次调用的分配数。
+ * 替换函数不允许内联：GCC若只内联其中一侧，会把malloc/free与operator new/delete配对检查而误报-Wmismatched-new-delete。
+ */
+std::atomic<size_t> allocation_count{0};
+
+[[gnu::noinline]] void* operator new(size_t size){
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    if(void* memory = std::malloc(size == 0 ? 1 : size)){
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+[[gnu::noinline]] void operator delete(void* memory) noexcept{ std::free(memory); }
+[[gnu::noinline]] void operator delete(void* memory, size_t) noexcept{ std::free(memory); }
+void* operator new[](size_t size){ return ::operator new(size); }
+void operator delete[](void* memory) noexcept{ ::operator delete(memory); }
+void operator delete[](void* memory, size_t) noexcept{ ::operator delete(memory); }
 
 /**
  * 抽象出的一般产品类提供了一个接口，所有具体产品都必须实现这个接口
@@ -8,22 +41,79 @@ class Product{
 public:
     virtual ~Product(){};
     virtual std::string Operation() const = 0;
+    // 不分配内存的版本：返回指向静态存储的视图
+    virtual std::string_view OperationView() const = 0;
 };
 
-class ConcreteProduct1 : public Product{
+class ConcreteProduct1 final : public Product{
 public:
     std::string Operation() const override{
+        return std::string(this->OperationView());
+    }
+    std::string_view OperationView() const override{
         return "{ConcreteProduct1}";
     }
 };
 
-class ConcreteProduct2 : public Product{
+class ConcreteProduct2 final : public Product{
 public:
     std::string Operation() const override{
+        return std::string(this->OperationView());
+    }
+    std::string_view OperationView() const override{
         return "{ConcreteProduct2}";
     }
 };
 
+/**
+ * 产品竞技场（Arena）是一块由调用者提供的连续内存。
+ * 工厂方法可以在其中通过placement new构造产品，避免每次都走全局堆分配。
+ * 竞技场只做指针递增式的分配，释放通过Rewind回退到标记位置或Reset整体清空完成。
+ * 注意：竞技场不会调用析构函数，放入其中的产品需要由使用者显式析构。
+ */
+class ProductArena{
+private:
+    std::unique_ptr<std::byte[]> buffer_;
+    size_t capacity_;
+    size_t offset_;
+public:
+    explicit ProductArena(size_t capacity)
+        : buffer_(new std::byte[capacity]), capacity_(capacity), offset_(0){}
+    ProductArena(const ProductArena&) = delete;
+    ProductArena& operator=(const ProductArena&) = delete;
+
+    void* Allocate(size_t size, size_t alignment){
+        std::uintptr_t base = reinterpret_cast<std::uintptr_t>(buffer_.get());
+        std::uintptr_t current = base + offset_;
+        std::uintptr_t aligned = (current + alignment - 1) & ~(static_cast<std::uintptr_t>(alignment) - 1);
+        size_t new_offset = static_cast<size_t>(aligned - base) + size;
+        if(new_offset > capacity_){
+            throw std::bad_alloc();
+        }
+        offset_ = new_offset;
+        return reinterpret_cast<void*>(aligned);
+    }
+    // 在竞技场中原地构造一个对象
+    template<typename T, typename... Args>
+    T* Create(Args&&... args){
+        void* memory = this->Allocate(sizeof(T), alignof(T));
+        return new (memory) T(std::forward<Args>(args)...);
+    }
+    // 标记与回退：用于在一次操作结束后归还这次操作用到的全部内存
+    size_t Mark() const { return offset_; }
+    void Rewind(size_t mark){ offset_ = mark; }
+    // 整体清空，所有已分配的内存一次性作废
+    void Reset(){ offset_ = 0; }
+    size_t Used() const { return offset_; }
+};
+/**
+ * 每个线程独占一个竞技场，多线程下不需要加锁，也不会争用全局分配器。
+ */
+ProductArena& ThreadLocalProductArena(){
+    thread_local ProductArena arena(4096);
+    return arena;
+}
+
 /**
  * 抽象出的一般创建者类提供了一个工厂方法，所有具体创建者都必须实现这个方法
  * 这个方法返回一个产品对象，所有具体创建者都必须实现这个方法
@@ -35,6 +125,8 @@ class Creator{
 public:
     virtual ~Creator(){};
     virtual Product* FactoryMethod() const = 0;
+    // 竞技场版本的工厂方法：产品构造在调用者提供的内存中，不能用delete释放
+    virtual Product* FactoryMethod(ProductArena& arena) const = 0;
 
     std::string SomeOperation() const{
         Product* product = this->FactoryMethod();
@@ -42,6 +134,24 @@ public:
         delete product;
         return result;
     }
+    // 与上面的业务逻辑相同，但产品来自竞技场，用完后显式析构并回退竞技场
+    std::string SomeOperation(ProductArena& arena) const{
+        size_t mark = arena.Mark();
+        Product* product = this->FactoryMethod(arena);
+        std::string result = "Creator: just worked with " + product->Operation();
+        product->~Product();
+        arena.Rewind(mark);
+        return result;
+    }
+    // 结果写入调用者提供的缓冲区，缓冲区容量足够时整个调用不会分配任何内存
+    void SomeOperation(ProductArena& arena, std::string& out) const{
+        size_t mark = arena.Mark();
+        Product* product = this->FactoryMethod(arena);
+        out.assign("Creator: just worked with ");
+        out.append(product->OperationView());
+        product->~Product();
+        arena.Rewind(mark);
+    }
 };
 /**
  * 具体创建者类提供了一个工厂方法的实现，这个方法返回一个具体产品对象
@@ -50,14 +160,20 @@ class ConcreteCreator1 : public Creator{
 public:
     Product* FactoryMethod() const override{
         return new ConcreteProduct1();
-    } 
+    }
+    Product* FactoryMethod(ProductArena& arena) const override{
+        return arena.Create<ConcreteProduct1>();
+    }
 };
 
 class ConcreteCreator2 : public Creator{
 public:
     Product* FactoryMethod() const override{
         return new ConcreteProduct2();
-    } 
+    }
+    Product* FactoryMethod(ProductArena& arena) const override{
+        return arena.Create<ConcreteProduct2>();
+    }
 };
 /**
  * 客户端代码可以使用任何具体创建者的实例，而无需关心具体创建者的类
@@ -69,6 +185,171 @@ void ClientCode(const Creator& creator){
     std::cout << creator.SomeOperation() << std::endl;
 }
 
+/**
+ * 静态创建者：在编译期绑定具体产品类型，不需要任何虚函数分派。
+ * 产品直接构造在栈上，且具体产品类型是final的，编译器可以把Operation内联进来。
+ */
+template<typename ConcreteProduct>
+class StaticCreator{
+public:
+    std::string SomeOperation() const{
+        ConcreteProduct product;
+        return "Creator: just worked with " + product.Operation();
+    }
+    void SomeOperation(std::string& out) const{
+        ConcreteProduct product;
+        out.assign("Creator: just worked with ");
+        out.append(product.OperationView());
+    }
+};
+// 所有可以在配置中选择的静态创建者
+using AnyStaticCreator = std::variant<StaticCreator<ConcreteProduct1>, StaticCreator<ConcreteProduct2>>;
+
+/**
+ * 创建者注册表：启动时把配置中的字符串键映射到静态创建者，只查找一次。
+ * 之后客户端通过std::visit拿到静态类型的创建者，热循环中不再有任何运行时分派。
+ */
+class CreatorRegistry{
+private:
+    std::unordered_map<std::string, AnyStaticCreator> creators_;
+public:
+    CreatorRegistry(){
+        creators_.emplace("product1", StaticCreator<ConcreteProduct1>{});
+        creators_.emplace("product2", StaticCreator<ConcreteProduct2>{});
+    }
+    void Register(const std::string& key, AnyStaticCreator creator){
+        creators_.insert_or_assign(key, creator);
+    }
+    // 未注册的键抛出异常，而不是悄悄返回一个默认创建者
+    const AnyStaticCreator& Resolve(const std::string& key) const{
+        auto it = creators_.find(key);
+        if(it == creators_.end()){
+            throw std::out_of_range("CreatorRegistry: unknown creator key " + key);
+        }
+        return it->second;
+    }
+};
+/**
+ * 静态版本的客户端代码，同样不关心具体创建者，但由模板在编译期实例化。
+ */
+template<typename StaticCreatorType>
+void StaticClientCode(const StaticCreatorType& creator){
+    std::cout << "Client: I'm not aware of the creator's class, and I don't pay for a virtual call\n";
+    std::cout << creator.SomeOperation() << std::endl;
+}
+
+/**
+ * 基准测试：比较SomeOperation在new/delete模式与竞技场模式下的耗时。
+ * 每个线程调用calls次，多线程时每个线程使用自己的线程局部竞技场。
+ */
+// 防止编译器把基准测试中的计算优化掉
+std::atomic<size_t> benchmark_sink{0};
+
+template<typename Func>
+double RunOnThreads(unsigned threads, Func func){
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for(unsigned i = 0; i < threads; i++){
+        workers.emplace_back(func);
+    }
+    for(std::thread& worker : workers){
+        worker.join();
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+void BenchmarkSomeOperation(const Creator& creator, size_t calls, unsigned threads){
+    double heap_ms = RunOnThreads(threads, [&creator, calls](){
+        size_t checksum = 0;
+        for(size_t i = 0; i < calls; i++){
+            checksum += creator.SomeOperation().size();
+        }
+        benchmark_sink.fetch_add(checksum, std::memory_order_relaxed);
+    });
+    double arena_ms = RunOnThreads(threads, [&creator, calls](){
+        ProductArena& arena = ThreadLocalProductArena();
+        size_t checksum = 0;
+        for(size_t i = 0; i < calls; i++){
+            checksum += creator.SomeOperation(arena).size();
+        }
+        benchmark_sink.fetch_add(checksum, std::memory_order_relaxed);
+    });
+    double total_calls = static_cast<double>(calls) * threads;
+    std::cout << "Benchmark: " << threads << " thread(s) x " << calls << " calls\n";
+    std::cout << "  new/delete : " << heap_ms << " ms (" << heap_ms * 1e6 / total_calls << " ns/call)\n";
+    std::cout << "  arena      : " << arena_ms << " ms (" << arena_ms * 1e6 / total_calls << " ns/call)\n";
+}
+
+/**
+ * 基准测试：比较虚函数路径与注册表给出的静态路径。
+ * std::visit放在循环外面，循环体内只剩可内联的静态调用。
+ */
+void BenchmarkDispatch(const Creator& creator, const AnyStaticCreator& static_creator, size_t calls){
+    // 两边都写入可复用的输出缓冲区，虚函数一侧的产品放在竞技场里，避免把堆分配算进分派开销
+    double virtual_ms = RunOnThreads(1, [&creator, calls](){
+        ProductArena& arena = ThreadLocalProductArena();
+        std::string out;
+        size_t checksum = 0;
+        for(size_t i = 0; i < calls; i++){
+            creator.SomeOperation(arena, out);
+            checksum += out.size();
+        }
+        benchmark_sink.fetch_add(checksum, std::memory_order_relaxed);
+    });
+    double static_ms = RunOnThreads(1, [&static_creator, calls](){
+        std::visit([calls](const auto& typed_creator){
+            std::string out;
+            size_t checksum = 0;
+            for(size_t i = 0; i < calls; i++){
+                typed_creator.SomeOperation(out);
+                checksum += out.size();
+            }
+            benchmark_sink.fetch_add(checksum, std::memory_order_relaxed);
+        }, static_creator);
+    });
+    double total_calls = static_cast<double>(calls);
+    std::cout << "Benchmark: dispatch x " << calls << " calls (arena + output buffer vs registry + output buffer)\n";
+    std::cout << "  virtual    : " << virtual_ms << " ms (" << virtual_ms * 1e6 / total_calls << " ns/call)\n";
+    std::cout << "  registry   : " << static_ms << " ms (" << static_ms * 1e6 / total_calls << " ns/call)\n";
+}
+
+template<typename Func>
+double AllocationsPerCall(size_t calls, Func func){
+    size_t before = allocation_count.load(std::memory_order_relaxed);
+    for(size_t i = 0; i < calls; i++){
+        func();
+    }
+    size_t after = allocation_count.load(std::memory_order_relaxed);
+    return static_cast<double>(after - before) / static_cast<double>(calls);
+}
+
+void BenchmarkAllocations(const Creator& creator, size_t calls){
+    ProductArena& arena = ThreadLocalProductArena();
+    StaticCreator<ConcreteProduct1> static_creator;
+    std::string out;
+    out.reserve(64);
+    double plain = AllocationsPerCall(calls, [&creator](){
+        benchmark_sink.fetch_add(creator.SomeOperation().size(), std::memory_order_relaxed);
+    });
+    double arena_string = AllocationsPerCall(calls, [&creator, &arena](){
+        benchmark_sink.fetch_add(creator.SomeOperation(arena).size(), std::memory_order_relaxed);
+    });
+    double arena_buffer = AllocationsPerCall(calls, [&creator, &arena, &out](){
+        creator.SomeOperation(arena, out);
+        benchmark_sink.fetch_add(out.size(), std::memory_order_relaxed);
+    });
+    double static_buffer = AllocationsPerCall(calls, [&static_creator, &out](){
+        static_creator.SomeOperation(out);
+        benchmark_sink.fetch_add(out.size(), std::memory_order_relaxed);
+    });
+    std::cout << "Benchmark: allocations per SomeOperation call\n";
+    std::cout << "  new/delete + std::string : " << plain << "\n";
+    std::cout << "  arena + std::string      : " << arena_string << "\n";
+    std::cout << "  arena + output buffer    : " << arena_buffer << "\n";
+    std::cout << "  registry + output buffer : " << static_buffer << "\n";
+}
+
 int main(){
    std::cout << "App: Launched with the ConcreteCreator1.\n";
    Creator* creator = new ConcreteCreator1();
@@ -77,6 +358,27 @@ int main(){
    std::cout << "App: Launched with the ConcreteCreator2.\n";
    Creator* creator2 = new ConcreteCreator2();
    ClientCode(*creator2);
+   std::cout << std::endl;
+
+   std::cout << "App: Launched with the ConcreteCreator1 and a caller-supplied arena.\n";
+   ProductArena arena(256);
+   std::cout << creator->SomeOperation(arena) << std::endl;
+   std::cout << std::endl;
+
+   // 启动时根据配置选择一次创建者，之后全部走静态路径
+   std::cout << "App: Launched with the creator registered as \"product2\".\n";
+   CreatorRegistry registry;
+   const AnyStaticCreator& configured = registry.Resolve("product2");
+   std::visit([](const auto& typed_creator){ StaticClientCode(typed_creator); }, configured);
+   std::cout << std::endl;
+
+   unsigned threads = std::thread::hardware_concurrency();
+   if(threads < 2) threads = 2;
+   BenchmarkSomeOperation(*creator, 2000000, 1);
+   BenchmarkSomeOperation(*creator, 2000000, threads);
+   BenchmarkDispatch(*creator2, configured, 2000000);
+   BenchmarkAllocations(*creator, 100000);
+
    delete creator;
    delete creator2; 
 }
@@ -1,4 +1,36 @@
 #include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <iomanip>
+#include <memory>
+#include <new>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * 统计全局分配次数，做法与工厂方法示例相同。
+ */
+std::atomic<size_t> allocation_count{0};
+
+[[gnu::noinline]] void* operator new(size_t size){
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    if(void* memory = std::malloc(size == 0 ? 1 : size)){
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+[[gnu::noinline]] void operator delete(void* memory) noexcept{ std::free(memory); }
+[[gnu::noinline]] void operator delete(void* memory, size_t) noexcept{ std::free(memory); }
+void* operator new[](size_t size){ return ::operator new(size); }
+void operator delete[](void* memory) noexcept{ ::operator delete(memory); }
+void operator delete[](void* memory, size_t) noexcept{ ::operator delete(memory); }
+
 /**
  * 每一种产品都应该有一个基础接口。
  * 所有的产品变体都必须实现这个接口。
@@ -7,6 +39,8 @@ class AbstractProductA{
 public:
     virtual ~AbstractProductA(){};
     virtual std::string UsefulFunctionA() const = 0;
+    // 不分配内存的版本：返回指向静态存储的视图
+    virtual std::string_view UsefulFunctionAView() const = 0;
 };
 /**
  * 具体的产品由相应的具体工厂创建。
@@ -14,6 +48,9 @@ public:
 class ConcreteProductA1 : public AbstractProductA{
 public:
     std::string UsefulFunctionA() const override{
+        return std::string(this->UsefulFunctionAView());
+    }
+    std::string_view UsefulFunctionAView() const override{
         return "Product A1";
     }
 };
@@ -21,6 +58,9 @@ public:
 class ConcreteProductA2 : public AbstractProductA{
 public:
     std::string UsefulFunctionA() const override{
+        return std::string(this->UsefulFunctionAView());
+    }
+    std::string_view UsefulFunctionAView() const override{
         return "Product A2";
     } 
 };
@@ -29,29 +69,221 @@ class AbstractProductB{
 public:
     virtual ~AbstractProductB(){};
     virtual std::string UsefulFunctionB() const = 0;
+    virtual std::string_view UsefulFunctionBView() const = 0;
     virtual std::string AnotherUsefulFunctionB(const AbstractProductA &collaborator) const = 0; 
+    // 结果写入调用者提供的缓冲区，缓冲区容量足够时不会分配任何内存
+    virtual void AnotherUsefulFunctionB(const AbstractProductA &collaborator, std::string &out) const = 0;
 };
 
 class ConcreteProductB1 : public AbstractProductB{
 public:
     std::string UsefulFunctionB() const override{
+        return std::string(this->UsefulFunctionBView());
+    }
+    std::string_view UsefulFunctionBView() const override{
         return "Product B1";
     }
     std::string AnotherUsefulFunctionB(const AbstractProductA &collaborator) const override{
         const std::string result = collaborator.UsefulFunctionA();
         return "B1 collaborates with the ( " + result + " )";     
-    } 
+    }
+    void AnotherUsefulFunctionB(const AbstractProductA &collaborator, std::string &out) const override{
+        out.assign("B1 collaborates with the ( ");
+        out.append(collaborator.UsefulFunctionAView());
+        out.append(" )");
+    }
 };
 
 class ConcreteProductB2 : public AbstractProductB{
 public:
     std::string UsefulFunctionB() const override{
+        return std::string(this->UsefulFunctionBView());
+    }
+    std::string_view UsefulFunctionBView() const override{
         return "Product B2";
     }
     std::string AnotherUsefulFunctionB(const AbstractProductA &collaborator) const override{
         const std::string result = collaborator.UsefulFunctionA();
         return "B2 collaborates with the ( " + result + " )";     
-    } 
+    }
+    void AnotherUsefulFunctionB(const AbstractProductA &collaborator, std::string &out) const override{
+        out.assign("B2 collaborates with the ( ");
+        out.append(collaborator.UsefulFunctionAView());
+        out.append(" )");
+    }
+};
+
+/**
+ * 一批同一家族的产品对：N个产品A与N个产品B放在同一次分配得到的连续内存里。
+ * 内存布局按产品种类分段（结构数组）：[A0 A1 ... An-1][B0 B1 ... Bn-1]。
+ * 同一批次内的产品A都是同一个具体类型，产品B也一样，所以可以用固定步长直接定位第i个产品，
+ * 遍历时是顺序访问，对缓存友好。
+ * 批次对象只能移动不能拷贝，析构时通过类型擦除的销毁函数析构所有产品并释放整块内存。
+ */
+class ProductFamilyBatch{
+private:
+    std::byte *memory_;
+    size_t count_;
+    std::byte *products_a_;
+    std::byte *products_b_;
+    // 第一个产品的抽象产品子对象，通过派生类到基类的转换得到，不假设它位于对象起始处
+    const AbstractProductA *first_a_;
+    const AbstractProductB *first_b_;
+    size_t stride_a_;
+    size_t stride_b_;
+    void (*destroy_)(ProductFamilyBatch &batch);
+
+    ProductFamilyBatch() : memory_(nullptr), count_(0), products_a_(nullptr), products_b_(nullptr),
+                           first_a_(nullptr), first_b_(nullptr), stride_a_(0), stride_b_(0), destroy_(nullptr){}
+
+    static size_t AlignUp(size_t offset, size_t alignment){
+        return (offset + alignment - 1) / alignment * alignment;
+    }
+
+public:
+    template<typename ConcreteA, typename ConcreteB>
+    static ProductFamilyBatch Create(size_t count){
+        ProductFamilyBatch batch;
+        size_t offset_b = AlignUp(sizeof(ConcreteA) * count, alignof(ConcreteB));
+        batch.memory_ = static_cast<std::byte *>(::operator new(offset_b + sizeof(ConcreteB) * count));
+        batch.products_a_ = batch.memory_;
+        batch.products_b_ = batch.memory_ + offset_b;
+        batch.first_a_ = static_cast<const AbstractProductA *>(reinterpret_cast<ConcreteA *>(batch.products_a_));
+        batch.first_b_ = static_cast<const AbstractProductB *>(reinterpret_cast<ConcreteB *>(batch.products_b_));
+        batch.stride_a_ = sizeof(ConcreteA);
+        batch.stride_b_ = sizeof(ConcreteB);
+        // 具体产品都是单继承、不抛异常的默认构造，这里直接原地构造
+        for(size_t i = 0; i < count; i++){
+            new (batch.products_a_ + i * sizeof(ConcreteA)) ConcreteA();
+            new (batch.products_b_ + i * sizeof(ConcreteB)) ConcreteB();
+        }
+        batch.count_ = count;
+        batch.destroy_ = [](ProductFamilyBatch &self){
+            for(size_t i = 0; i < self.count_; i++){
+                reinterpret_cast<ConcreteA *>(self.products_a_ + i * sizeof(ConcreteA))->~ConcreteA();
+                reinterpret_cast<ConcreteB *>(self.products_b_ + i * sizeof(ConcreteB))->~ConcreteB();
+            }
+        };
+        return batch;
+    }
+
+    ProductFamilyBatch(ProductFamilyBatch &&other) noexcept : ProductFamilyBatch(){
+        this->Swap(other);
+    }
+    ProductFamilyBatch &operator=(ProductFamilyBatch &&other) noexcept{
+        ProductFamilyBatch released(std::move(other));
+        this->Swap(released);
+        return *this;
+    }
+    ProductFamilyBatch(const ProductFamilyBatch &) = delete;
+    ProductFamilyBatch &operator=(const ProductFamilyBatch &) = delete;
+    ~ProductFamilyBatch(){
+        if(memory_ != nullptr){
+            destroy_(*this);
+            ::operator delete(memory_);
+        }
+    }
+
+    void Swap(ProductFamilyBatch &other) noexcept{
+        std::swap(memory_, other.memory_);
+        std::swap(count_, other.count_);
+        std::swap(products_a_, other.products_a_);
+        std::swap(products_b_, other.products_b_);
+        std::swap(first_a_, other.first_a_);
+        std::swap(first_b_, other.first_b_);
+        std::swap(stride_a_, other.stride_a_);
+        std::swap(stride_b_, other.stride_b_);
+        std::swap(destroy_, other.destroy_);
+    }
+
+    size_t Size() const { return count_; }
+    // 每个产品的抽象子对象与第一个产品的相差整数个步长
+    const AbstractProductA &ProductA(size_t i) const{
+        return *reinterpret_cast<const AbstractProductA *>(reinterpret_cast<const std::byte *>(first_a_) + i * stride_a_);
+    }
+    const AbstractProductB &ProductB(size_t i) const{
+        return *reinterpret_cast<const AbstractProductB *>(reinterpret_cast<const std::byte *>(first_b_) + i * stride_b_);
+    }
+    // 按顺序遍历所有产品对
+    template<typename Func>
+    void ForEachPair(Func func) const{
+        for(size_t i = 0; i < count_; i++){
+            func(this->ProductA(i), this->ProductB(i));
+        }
+    }
+};
+
+/**
+ * 池化产品：用unique_ptr管理，删除器不释放内存，而是把对象归还到线程局部的回收池。
+ */
+template<typename AbstractProduct>
+struct ProductRecycler{
+    void (*recycle_)(AbstractProduct *product);
+    void operator()(AbstractProduct *product) const { recycle_(product); }
+};
+template<typename AbstractProduct>
+using PooledProduct = std::unique_ptr<AbstractProduct, ProductRecycler<AbstractProduct>>;
+
+/**
+ * 线程局部回收池：每个具体产品类型在每个线程中各有一条空闲链表。
+ * 获取与归还只操作当前线程自己的链表，不需要任何锁或原子操作，也不会争用全局分配器。
+ * 一个产品可以在别的线程归还，此时它的内存进入归还线程的链表。
+ * 每条链表最多缓存kMaxCached个空闲块，超出的部分直接还给全局分配器，避免生产者/消费者线程间无限增长。
+ */
+template<typename Concrete>
+class ThreadLocalProductPool{
+private:
+    struct FreeSlot{
+        FreeSlot *next;
+    };
+    static constexpr size_t kSlotSize = sizeof(Concrete) > sizeof(FreeSlot) ? sizeof(Concrete) : sizeof(FreeSlot);
+    static constexpr size_t kMaxCached = 4096;
+
+    struct FreeList{
+        FreeSlot *head = nullptr;
+        size_t size = 0;
+        ~FreeList(){
+            while(head != nullptr){
+                FreeSlot *next = head->next;
+                ::operator delete(head);
+                head = next;
+            }
+        }
+    };
+    static FreeList &Local(){
+        static thread_local FreeList free_list;
+        return free_list;
+    }
+
+public:
+    template<typename AbstractProduct>
+    static PooledProduct<AbstractProduct> Acquire(){
+        FreeList &free_list = Local();
+        void *memory;
+        if(free_list.head != nullptr){
+            memory = free_list.head;
+            free_list.head = free_list.head->next;
+            free_list.size--;
+        }else{
+            memory = ::operator new(kSlotSize);
+        }
+        AbstractProduct *product = new (memory) Concrete();
+        return PooledProduct<AbstractProduct>(product, ProductRecycler<AbstractProduct>{&Release<AbstractProduct>});
+    }
+
+    template<typename AbstractProduct>
+    static void Release(AbstractProduct *product){
+        Concrete *concrete = static_cast<Concrete *>(product);
+        concrete->~Concrete();
+        FreeList &free_list = Local();
+        if(free_list.size >= kMaxCached){
+            ::operator delete(static_cast<void *>(concrete));
+            return;
+        }
+        FreeSlot *slot = new (static_cast<void *>(concrete)) FreeSlot{free_list.head};
+        free_list.head = slot;
+        free_list.size++;
+    }
 };
 
 /**
@@ -66,6 +298,11 @@ public:
     virtual ~AbstractFactory(){};
     virtual AbstractProductA *CreateProductA() const = 0;
     virtual AbstractProductB *CreateProductB() const = 0; 
+    // 批量创建count对相互兼容的产品，只做一次分配
+    virtual ProductFamilyBatch CreateProductFamilies(size_t count) const = 0;
+    // 从当前线程的回收池中获取产品，产品离开作用域时自动归还
+    virtual PooledProduct<AbstractProductA> CreatePooledProductA() const = 0;
+    virtual PooledProduct<AbstractProductB> CreatePooledProductB() const = 0;
 };
 
 class ConcreteFactory1 : public AbstractFactory{
@@ -75,7 +312,16 @@ public:
     }
     AbstractProductB *CreateProductB() const override{
         return new ConcreteProductB1();
-    } 
+    }
+    ProductFamilyBatch CreateProductFamilies(size_t count) const override{
+        return ProductFamilyBatch::Create<ConcreteProductA1, ConcreteProductB1>(count);
+    }
+    PooledProduct<AbstractProductA> CreatePooledProductA() const override{
+        return ThreadLocalProductPool<ConcreteProductA1>::Acquire<AbstractProductA>();
+    }
+    PooledProduct<AbstractProductB> CreatePooledProductB() const override{
+        return ThreadLocalProductPool<ConcreteProductB1>::Acquire<AbstractProductB>();
+    }
 };
 
 class ConcreteFactory2 : public AbstractFactory{
@@ -85,7 +331,16 @@ public:
     }
     AbstractProductB *CreateProductB() const override{
         return new ConcreteProductB2();
-    } 
+    }
+    ProductFamilyBatch CreateProductFamilies(size_t count) const override{
+        return ProductFamilyBatch::Create<ConcreteProductA2, ConcreteProductB2>(count);
+    }
+    PooledProduct<AbstractProductA> CreatePooledProductA() const override{
+        return ThreadLocalProductPool<ConcreteProductA2>::Acquire<AbstractProductA>();
+    }
+    PooledProduct<AbstractProductB> CreatePooledProductB() const override{
+        return ThreadLocalProductPool<ConcreteProductB2>::Acquire<AbstractProductB>();
+    }
 };
 
 /**
@@ -101,6 +356,154 @@ void ClientCode(const AbstractFactory &factory){
     delete product_b;
 }
 
+/**
+ * 批量版本的客户端代码：一次拿到多对产品，依次让产品B与同一对中的产品A协作。
+ */
+void BatchClientCode(const AbstractFactory &factory, size_t count){
+    ProductFamilyBatch batch = factory.CreateProductFamilies(count);
+    std::string out;
+    batch.ForEachPair([&out](const AbstractProductA &product_a, const AbstractProductB &product_b){
+        product_b.AnotherUsefulFunctionB(product_a, out);
+        std::cout << out << "\n";
+    });
+}
+
+/**
+ * 基准测试：统计产品接口每次调用的分配次数与耗时，比较返回std::string与写入输出缓冲区两种接口。
+ */
+template<typename Func>
+void MeasureCalls(const char* label, size_t calls, Func func){
+    size_t before = allocation_count.load(std::memory_order_relaxed);
+    auto start = std::chrono::steady_clock::now();
+    for(size_t i = 0; i < calls; i++){
+        func();
+    }
+    auto end = std::chrono::steady_clock::now();
+    size_t after = allocation_count.load(std::memory_order_relaxed);
+    double ns = std::chrono::duration<double, std::nano>(end - start).count();
+    std::cout << "  " << std::left << std::setw(28) << label << ": " << static_cast<double>(after - before) / calls << " allocs/call, "
+              << ns / calls << " ns/call\n";
+}
+
+void BenchmarkAllocations(const AbstractFactory &factory, size_t calls){
+    const AbstractProductA *product_a = factory.CreateProductA();
+    const AbstractProductB *product_b = factory.CreateProductB();
+    size_t checksum = 0;
+    std::string out;
+    out.reserve(64);
+    std::cout << "Benchmark: " << calls << " calls per interface\n";
+    MeasureCalls("UsefulFunctionA", calls, [&](){ checksum += product_a->UsefulFunctionA().size(); });
+    MeasureCalls("UsefulFunctionAView", calls, [&](){ checksum += product_a->UsefulFunctionAView().size(); });
+    MeasureCalls("UsefulFunctionB", calls, [&](){ checksum += product_b->UsefulFunctionB().size(); });
+    MeasureCalls("UsefulFunctionBView", calls, [&](){ checksum += product_b->UsefulFunctionBView().size(); });
+    MeasureCalls("AnotherUsefulFunctionB", calls, [&](){ checksum += product_b->AnotherUsefulFunctionB(*product_a).size(); });
+    MeasureCalls("AnotherUsefulFunctionB(out)", calls, [&](){
+        product_b->AnotherUsefulFunctionB(*product_a, out);
+        checksum += out.size();
+    });
+    std::cout << "  (checksum " << checksum << ")\n";
+    delete product_a;
+    delete product_b;
+}
+
+/**
+ * 基准测试：创建count对产品并执行一遍协作步骤，比较逐个new与批量创建。
+ */
+void BenchmarkBatchCreation(const AbstractFactory &factory, size_t count){
+    size_t checksum = 0;
+    std::string out;
+    out.reserve(64);
+    std::cout << "Benchmark: " << count << " product pairs\n";
+
+    std::vector<const AbstractProductA *> products_a;
+    std::vector<const AbstractProductB *> products_b;
+    MeasureCalls("one-by-one create", count, [&](){
+        products_a.push_back(factory.CreateProductA());
+        products_b.push_back(factory.CreateProductB());
+    });
+    size_t index = 0;
+    MeasureCalls("one-by-one collaborate", count, [&](){
+        products_b[index]->AnotherUsefulFunctionB(*products_a[index], out);
+        checksum += out.size();
+        index++;
+    });
+    for(size_t i = 0; i < count; i++){
+        delete products_a[i];
+        delete products_b[i];
+    }
+
+    // 批量创建只调用一次，这里把总开销平摊到每一对产品上
+    size_t before = allocation_count.load(std::memory_order_relaxed);
+    auto start = std::chrono::steady_clock::now();
+    ProductFamilyBatch batch = factory.CreateProductFamilies(count);
+    auto end = std::chrono::steady_clock::now();
+    size_t after = allocation_count.load(std::memory_order_relaxed);
+    std::cout << "  " << std::left << std::setw(28) << "batch create" << ": "
+              << static_cast<double>(after - before) / count << " allocs/call, "
+              << std::chrono::duration<double, std::nano>(end - start).count() / count << " ns/call\n";
+    index = 0;
+    MeasureCalls("batch collaborate", count, [&](){
+        batch.ProductB(index).AnotherUsefulFunctionB(batch.ProductA(index), out);
+        checksum += out.size();
+        index++;
+    });
+    std::cout << "  (checksum " << checksum << ")\n";
+}
+
+/**
+ * 基准测试：1到N个线程同时高频创建、销毁产品对，比较全局分配器与线程局部回收池的吞吐量。
+ */
+template<typename Func>
+double MeasureThreadsMs(unsigned threads, Func func){
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for(unsigned i = 0; i < threads; i++){
+        workers.emplace_back(func);
+    }
+    for(std::thread &worker : workers){
+        worker.join();
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+void BenchmarkPoolScaling(const AbstractFactory &factory, size_t pairs_per_thread){
+    std::atomic<size_t> checksum{0};
+    unsigned max_threads = std::max(2u, std::thread::hardware_concurrency());
+    std::cout << "Benchmark: create/destroy " << pairs_per_thread << " product pairs per thread\n";
+    std::vector<unsigned> thread_counts;
+    for(unsigned threads = 1; threads < max_threads; threads *= 2){
+        thread_counts.push_back(threads);
+    }
+    thread_counts.push_back(max_threads);
+    for(unsigned threads : thread_counts){
+        double heap_ms = MeasureThreadsMs(threads, [&](){
+            size_t local = 0;
+            for(size_t i = 0; i < pairs_per_thread; i++){
+                const AbstractProductA *product_a = factory.CreateProductA();
+                const AbstractProductB *product_b = factory.CreateProductB();
+                local += product_b->UsefulFunctionBView().size() + product_a->UsefulFunctionAView().size();
+                delete product_a;
+                delete product_b;
+            }
+            checksum.fetch_add(local, std::memory_order_relaxed);
+        });
+        double pool_ms = MeasureThreadsMs(threads, [&](){
+            size_t local = 0;
+            for(size_t i = 0; i < pairs_per_thread; i++){
+                PooledProduct<AbstractProductA> product_a = factory.CreatePooledProductA();
+                PooledProduct<AbstractProductB> product_b = factory.CreatePooledProductB();
+                local += product_b->UsefulFunctionBView().size() + product_a->UsefulFunctionAView().size();
+            }
+            checksum.fetch_add(local, std::memory_order_relaxed);
+        });
+        double total_pairs = static_cast<double>(pairs_per_thread) * threads;
+        std::cout << "  " << threads << " thread(s): new/delete " << total_pairs / heap_ms / 1000.0
+                  << " Mpairs/s, pooled " << total_pairs / pool_ms / 1000.0 << " Mpairs/s\n";
+    }
+    std::cout << "  (checksum " << checksum.load() << ")\n";
+}
+
 /**
  * 下面的代码先测试一个产品家族，然后测试另一个产品家族。
  */
@@ -113,6 +516,13 @@ int main(){
     std::cout << "Client: Testing the same client code with the second factory type:\n";
     ConcreteFactory2 *factory2 = new ConcreteFactory2();
     ClientCode(*factory2);
+    std::cout << "\n";
+    std::cout << "Client: Creating a batch of compatible products with the second factory type:\n";
+    BatchClientCode(*factory2, 3);
+    std::cout << "\n";
+    BenchmarkAllocations(*factory2, 1000000);
+    BenchmarkBatchCreation(*factory2, 1000000);
+    BenchmarkPoolScaling(*factory2, 1000000);
     delete factory2;
     return 0;
 }
\ No newline at end of file
@@ -1,5 +1,33 @@
 #include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
 #include <vector>
+
+/**
+ * 全局分配计数，供基准测试统计每个产品的分配次数（与工厂方法示例相同的替换分配函数）。
+ */
+std::atomic<size_t> allocation_count{0};
+
+[[gnu::noinline]] void* operator new(size_t size){
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    if(void* memory = std::malloc(size == 0 ? 1 : size)){
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+[[gnu::noinline]] void operator delete(void* memory) noexcept{ std::free(memory); }
+[[gnu::noinline]] void operator delete(void* memory, size_t) noexcept{ std::free(memory); }
+void* operator new[](size_t size){ return ::operator new(size); }
+void operator delete[](void* memory) noexcept{ ::operator delete(memory); }
+void operator delete[](void* memory, size_t) noexcept{ ::operator delete(memory); }
 /**
  * 在产品非常复杂并且需要 extensive configuration 的情况下，
  * 可以使用 Builder 模式。
@@ -11,14 +39,28 @@ public:
     std::vector<std::string> parts_;
     void ListParts()const{
         std::cout << "Product parts: ";
+        this->WriteParts([](std::string_view text){
+            std::cout.write(text.data(), static_cast<std::streamsize>(text.size()));
+        });
+    }
+    /**
+     * 流式序列化：一次遍历，把部件依次写入任意输出端。
+     * 输出端是一个接受std::string_view的可调用对象，例如追加到缓冲区或写入流。
+     * 分隔符由下标决定，不再与最后一个部件做字符串比较，部件重复时输出也是正确的。
+     */
+    template<typename Sink>
+    void WriteParts(Sink&& sink)const{
         for(size_t i = 0; i < parts_.size(); i++){
-            if(parts_[i] == parts_.back()){
-                std::cout << parts_[i];
-            }else{
-                std::cout << parts_[i] << ", ";
+            if(i != 0){
+                sink(std::string_view(", "));
             }
+            sink(std::string_view(parts_[i]));
         }
     }
+    // 追加到调用者提供的可复用缓冲区，缓冲区容量足够时不产生分配
+    void WriteParts(std::string& buffer)const{
+        this->WriteParts([&buffer](std::string_view text){ buffer.append(text); });
+    }
 };
 /**
  * 构建器接口指定创建产品不同部分的方法。
@@ -29,6 +71,8 @@ public:
     virtual void ProducePartA() const = 0;
     virtual void ProducePartB() const = 0;
     virtual void ProducePartC() const = 0;
+    // 导演在构建前告知部件数量，构建器可以据此一次性预留存储；默认忽略
+    virtual void Reserve(size_t /*part_count*/) const {}
 };
 /**
  * 具体构建器类遵循构建器接口并提供构建步骤的特定实现。
@@ -64,6 +108,45 @@ public:
         return this->product; 
     }
 };
+/**
+ * 可复用的构建器：产品由构建器持有，构建完成后通过TakeProduct移动给调用者，构建器不再拥有它。
+ * 部件直接在产品的存储中原地构造（部件名都在短字符串优化范围内，不产生堆分配）。
+ * Reset只清空部件而保留容量；调用者用完产品后可以把它交还给Reset，
+ * 这样下一次构建复用同一块缓冲区，稳定状态下构建产品不再有任何分配。
+ */
+class ReusableBuilder1 : public Builder{
+private:
+    std::unique_ptr<Product1> product_;
+public:
+    ReusableBuilder1() : product_(new Product1()){}
+
+    void Reset(){
+        this->product_->parts_.clear();
+    }
+    void Reset(Product1&& recycled){
+        *this->product_ = std::move(recycled);
+        this->product_->parts_.clear();
+    }
+    void Reserve(size_t part_count) const override{
+        this->product_->parts_.reserve(part_count);
+    }
+
+    void ProducePartA() const override{
+        this->product_->parts_.emplace_back("PartA1");
+    }
+    void ProducePartB() const override{
+        this->product_->parts_.emplace_back("PartB1");
+    }
+    void ProducePartC() const override{
+        this->product_->parts_.emplace_back("PartC1");
+    }
+
+    Product1 TakeProduct(){
+        Product1 product = std::move(*this->product_);
+        this->product_->parts_.clear();
+        return product;
+    }
+};
 /**
  * 导演类定义了构建步骤的顺序。
  * 它通过实现的不同方法允许创建不同类型的产品。
@@ -77,15 +160,76 @@ public:
     }
     // 基本类型的产品
     void BuildMinimalViableProduct(){
+        this->builder->Reserve(1);
         this->builder->ProducePartA();
     }
     // 完整的类型的产品
     void BuildFullFeaturedProduct(){
+        this->builder->Reserve(3);
         this->builder->ProducePartA();
         this->builder->ProducePartB();
         this->builder->ProducePartC();
     }
 };
+/**
+ * 构建配方：对应导演类中的一种构建步骤。
+ */
+enum Recipe{
+    MINIMAL_VIABLE_PRODUCT = 0,
+    FULL_FEATURED_PRODUCT
+};
+/**
+ * 并行导演：把一批配方分发给多个工作线程同时构建，每次Build启动workers_个工作线程（含调用线程）。
+ * 每个工作线程有自己的导演和构建器，构建器之间不共享任何状态。
+ * 工作线程通过一个原子计数器按块领取配方，产品直接移动到结果数组中与配方相同的下标处，
+ * 每个下标只有一个线程写入，收集结果不需要任何锁。
+ */
+class ParallelDirector{
+private:
+    static constexpr size_t kChunkSize = 256;
+    unsigned workers_;
+
+    static void FollowRecipe(Director& director, Recipe recipe){
+        if(recipe == MINIMAL_VIABLE_PRODUCT){
+            director.BuildMinimalViableProduct();
+        }else{
+            director.BuildFullFeaturedProduct();
+        }
+    }
+public:
+    explicit ParallelDirector(unsigned workers) : workers_(std::max(1u, workers)){}
+
+    std::vector<Product1> Build(const std::vector<Recipe>& recipes) const{
+        std::vector<Product1> products(recipes.size());
+        std::atomic<size_t> next{0};
+        auto worker = [&recipes, &products, &next](){
+            ReusableBuilder1 builder;
+            Director director;
+            director.SetBuilder(&builder);
+            for(;;){
+                size_t begin = next.fetch_add(kChunkSize, std::memory_order_relaxed);
+                if(begin >= recipes.size()){
+                    break;
+                }
+                size_t end = std::min(begin + kChunkSize, recipes.size());
+                for(size_t i = begin; i < end; i++){
+                    FollowRecipe(director, recipes[i]);
+                    products[i] = builder.TakeProduct();
+                }
+            }
+        };
+        std::vector<std::thread> threads;
+        for(unsigned i = 1; i < workers_; i++){
+            threads.emplace_back(worker);
+        }
+        // 当前线程也作为一个工作线程参与构建
+        worker();
+        for(std::thread& thread : threads){
+            thread.join();
+        }
+        return products;
+    }
+};
 /**
  * 客户端代码创建一个构建器对象，将其传递给导演，并启动构建过程。
  * 最终结果从构建器对象中获取。
@@ -109,10 +253,151 @@ void ClientCode(Director& director){
     delete builder2;
 }
 
+/**
+ * 基准测试：构建count个完整产品，比较每次新建构建器与复用构建器两种方式的耗时和分配次数。
+ */
+template<typename Func>
+void MeasureBuilds(const char* label, size_t count, Func func){
+    size_t before = allocation_count.load(std::memory_order_relaxed);
+    auto start = std::chrono::steady_clock::now();
+    for(size_t i = 0; i < count; i++){
+        func();
+    }
+    auto end = std::chrono::steady_clock::now();
+    size_t after = allocation_count.load(std::memory_order_relaxed);
+    double ns = std::chrono::duration<double, std::nano>(end - start).count();
+    std::cout << "  " << label << ": " << ns / count << " ns/product, "
+              << static_cast<double>(after - before) / count << " allocs/product\n";
+}
+
+void BenchmarkBuilders(size_t count){
+    Director director;
+    size_t checksum = 0;
+    std::cout << "Benchmark: building " << count << " full featured products\n";
+    MeasureBuilds("new builder     ", count, [&](){
+        ConcreteBuilder1* builder = new ConcreteBuilder1();
+        director.SetBuilder(builder);
+        director.BuildFullFeaturedProduct();
+        checksum += builder->GetProduct()->parts_.size();
+        delete builder;
+    });
+    ReusableBuilder1 reusable;
+    director.SetBuilder(&reusable);
+    MeasureBuilds("reusable builder", count, [&](){
+        director.BuildFullFeaturedProduct();
+        Product1 product = reusable.TakeProduct();
+        checksum += product.parts_.size();
+        reusable.Reset(std::move(product));
+    });
+    std::cout << "  (checksum " << checksum << ")\n";
+}
+
+/**
+ * 基准测试：序列化一个含有大量部件的产品，比较原来的“与最后一个部件比较”写法和流式序列化。
+ */
+void BenchmarkSerialization(size_t part_count, size_t rounds){
+    Product1 product;
+    product.parts_.reserve(part_count);
+    for(size_t i = 0; i < part_count; i++){
+        product.parts_.emplace_back("Part" + std::to_string(i % 100));
+    }
+    std::string buffer;
+    size_t checksum = 0;
+    std::cout << "Benchmark: serializing a product with " << part_count << " parts\n";
+    MeasureBuilds("compare with back", rounds, [&](){
+        buffer.clear();
+        for(size_t i = 0; i < product.parts_.size(); i++){
+            if(product.parts_[i] == product.parts_.back()){
+                buffer += product.parts_[i];
+            }else{
+                buffer += product.parts_[i];
+                buffer += ", ";
+            }
+        }
+        checksum += buffer.size();
+    });
+    MeasureBuilds("streaming writer ", rounds, [&](){
+        buffer.clear();
+        product.WriteParts(buffer);
+        checksum += buffer.size();
+    });
+    std::cout << "  (checksum " << checksum << ")\n";
+}
+
+/**
+ * 基准测试：构建一整批产品，比较原来逐个新建构建器的顺序方式与并行导演在不同工作线程数下的吞吐量。
+ */
+void BenchmarkParallelDirector(size_t count){
+    std::vector<Recipe> recipes(count);
+    for(size_t i = 0; i < count; i++){
+        recipes[i] = i % 4 == 0 ? MINIMAL_VIABLE_PRODUCT : FULL_FEATURED_PRODUCT;
+    }
+    size_t checksum = 0;
+    std::cout << "Benchmark: building a catalog of " << count << " products\n";
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<Product1> sequential;
+    sequential.reserve(count);
+    Director director;
+    for(Recipe recipe : recipes){
+        ConcreteBuilder1* builder = new ConcreteBuilder1();
+        director.SetBuilder(builder);
+        if(recipe == MINIMAL_VIABLE_PRODUCT){
+            director.BuildMinimalViableProduct();
+        }else{
+            director.BuildFullFeaturedProduct();
+        }
+        sequential.push_back(*builder->GetProduct());
+        delete builder;
+    }
+    double sequential_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    checksum += sequential.size();
+    std::cout << "  sequential ClientCode path: " << count / sequential_ms / 1000.0 << " Mproducts/s\n";
+
+    unsigned max_workers = std::max(2u, std::thread::hardware_concurrency());
+    for(unsigned workers = 1; workers <= max_workers; workers *= 2){
+        ParallelDirector parallel(workers);
+        start = std::chrono::steady_clock::now();
+        std::vector<Product1> products = parallel.Build(recipes);
+        double parallel_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        checksum += products.size();
+        std::cout << "  parallel director, " << workers << " worker(s): " << count / parallel_ms / 1000.0 << " Mproducts/s\n";
+    }
+    std::cout << "  (checksum " << checksum << ")\n";
+}
+
 int main(){
     Director* director = new Director();
     ClientCode(*director);
+
+    std::cout << "Reusable builder, product moved out to the client: \n";
+    ReusableBuilder1 reusable;
+    director->SetBuilder(&reusable);
+    director->BuildFullFeaturedProduct();
+    Product1 product = reusable.TakeProduct();
+    product.ListParts();
+    std::cout << "\n------------------------------------------\n";
+    reusable.Reset(std::move(product));
+
+    std::cout << "Product with repeated parts: \n";
+    reusable.ProducePartA();
+    reusable.ProducePartB();
+    reusable.ProducePartA();
+    reusable.TakeProduct().ListParts();
+    std::cout << "\n------------------------------------------\n";
+
+    std::cout << "Catalog built by the parallel director: \n";
+    ParallelDirector parallel(2);
+    for(const Product1& built : parallel.Build({MINIMAL_VIABLE_PRODUCT, FULL_FEATURED_PRODUCT})){
+        built.ListParts();
+        std::cout << "\n";
+    }
+    std::cout << "------------------------------------------\n";
     delete director; 
+
+    BenchmarkBuilders(1000000);
+    BenchmarkSerialization(10000, 1000);
+    BenchmarkParallelDirector(1000000);
     return 0;
 }
 
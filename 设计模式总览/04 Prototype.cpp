@@ -1,6 +1,15 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include <array>
 #include <functional>
 #include <iostream>
+#include <memory>
+#include <new>
+#include <random>
 #include <unordered_map>
+#include <vector>
 
 using std::string;
 /**
@@ -14,22 +23,203 @@ using std::string;
  */
 enum Type{
     PROTOTYPE_1 = 0,
-    PROTOTYPE_2
+    PROTOTYPE_2,
+    // 运行时注册的原型从这个编号开始，编号必须小于MAX_PROTOTYPE_TYPES
+    FIRST_RUNTIME_TYPE,
+    MAX_PROTOTYPE_TYPES = 32
 };
 
+class PrototypePool;
+class PrototypeBlock;
+
 class Prototype{
 protected:
-    string prototype_name_;
-    float protptype_field_;
+    // 名称是原型中不可变的部分，所有克隆共享同一份字符串（写时复制），克隆时只增加引用计数
+    std::shared_ptr<const string> prototype_name_;
+    float protptype_field_ = 0.0f;
+
+    static const std::shared_ptr<const string>& EmptyName(){
+        static const std::shared_ptr<const string> empty = std::make_shared<const string>();
+        return empty;
+    }
 
 public:
-    Prototype(){}
-    Prototype(string prototype_name):prototype_name_(prototype_name){}
+    // 默认构造的原型共享同一个空名称
+    Prototype():prototype_name_(EmptyName()){}
+    Prototype(string prototype_name):prototype_name_(std::make_shared<const string>(std::move(prototype_name))){}
     virtual ~Prototype(){}
     virtual Prototype* Clone() const = 0;
+    // 克隆到对象池中，只复制可变字段
+    virtual Prototype* Clone(PrototypePool& pool) const = 0;
+    // 一次克隆count个实例，放在同一块连续内存中
+    virtual PrototypeBlock CloneN(size_t count) const = 0;
     virtual void Method(float prototype_field){
+        this->Update(prototype_field);
+        std::cout << "Call Method from " << *prototype_name_ << " with field : " << prototype_field << std::endl;
+    }
+    // Method中不带输出的部分，供批量处理使用
+    virtual void Update(float prototype_field){
         this->protptype_field_ = prototype_field;
-        std::cout << "Call Method from " << prototype_name_ << " with field : " << prototype_field << std::endl;
+    }
+    float Field() const { return protptype_field_; }
+    const string& Name() const { return *prototype_name_; }
+    // 写时复制：改名时才分配新的字符串，不影响共享旧名称的其他克隆
+    void Rename(string prototype_name){
+        this->prototype_name_ = std::make_shared<const string>(std::move(prototype_name));
+    }
+};
+
+/**
+ * 原型对象池：所有具体原型共用一种固定大小的槽位，空闲槽位串成链表。
+ * 从池中克隆时不经过全局分配器，释放时槽位回到链表中等待下一次克隆。
+ * 对象池不是线程安全的，每个线程应当使用自己的对象池。
+ */
+class PrototypePool{
+private:
+    struct FreeSlot{
+        FreeSlot* next;
+    };
+    size_t slot_size_;
+    FreeSlot* free_list_;
+    std::vector<void*> blocks_;
+
+public:
+    explicit PrototypePool(size_t slot_size) : slot_size_(std::max(slot_size, sizeof(FreeSlot))), free_list_(nullptr){}
+    PrototypePool(const PrototypePool&) = delete;
+    PrototypePool& operator=(const PrototypePool&) = delete;
+    ~PrototypePool(){
+        for(void* block : blocks_){
+            ::operator delete(block);
+        }
+    }
+
+    template<typename ConcretePrototype>
+    Prototype* Create(const ConcretePrototype& source){
+        static_assert(alignof(ConcretePrototype) <= alignof(std::max_align_t), "PrototypePool: over-aligned prototype");
+        if(sizeof(ConcretePrototype) > slot_size_){
+            throw std::bad_alloc();
+        }
+        if(free_list_ == nullptr){
+            this->Grow();
+        }
+        void* memory = free_list_;
+        free_list_ = free_list_->next;
+        return new (memory) ConcretePrototype(source);
+    }
+
+    void Destroy(Prototype* prototype){
+        if(prototype == nullptr){
+            return;
+        }
+        void* memory = dynamic_cast<void*>(prototype);
+        prototype->~Prototype();
+        free_list_ = new (memory) FreeSlot{free_list_};
+    }
+
+    // 交给unique_ptr使用的删除器，析构时把对象还给对象池
+    struct Deleter{
+        PrototypePool* pool_;
+        void operator()(Prototype* prototype) const { pool_->Destroy(prototype); }
+    };
+
+private:
+    // 一次申请一整块内存，切分成多个槽位
+    void Grow(){
+        const size_t slots_per_block = 256;
+        size_t stride = (slot_size_ + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) * alignof(std::max_align_t);
+        std::byte* block = static_cast<std::byte*>(::operator new(stride * slots_per_block));
+        blocks_.push_back(block);
+        for(size_t i = 0; i < slots_per_block; i++){
+            free_list_ = new (block + i * stride) FreeSlot{free_list_};
+        }
+    }
+};
+using PooledPrototype = std::unique_ptr<Prototype, PrototypePool::Deleter>;
+
+/**
+ * 一块连续存放的同类型克隆：count个具体原型按固定步长排列在一次分配得到的内存里。
+ * 通过基类指针加步长定位第i个实例，遍历时是顺序访问，对缓存友好。
+ * 具体类型在创建时被擦除，析构时通过保存的销毁函数逐个析构并释放整块内存。
+ */
+class PrototypeBlock{
+private:
+    std::byte* memory_;
+    Prototype* first_;
+    size_t count_;
+    size_t stride_;
+    void (*destroy_)(std::byte* memory, size_t count);
+
+public:
+    PrototypeBlock() : memory_(nullptr), first_(nullptr), count_(0), stride_(0), destroy_(nullptr){}
+
+    template<typename ConcretePrototype>
+    static PrototypeBlock Create(const ConcretePrototype& source, size_t count){
+        PrototypeBlock block;
+        if(count == 0){
+            return block;
+        }
+        block.memory_ = static_cast<std::byte*>(::operator new(sizeof(ConcretePrototype) * count));
+        size_t constructed = 0;
+        try{
+            for(; constructed < count; constructed++){
+                new (block.memory_ + constructed * sizeof(ConcretePrototype)) ConcretePrototype(source);
+            }
+        }catch(...){
+            Destroy<ConcretePrototype>(block.memory_, constructed);
+            ::operator delete(block.memory_);
+            block.memory_ = nullptr;
+            throw;
+        }
+        // 基类子对象在每个实例中的偏移相同，所以基类指针同样可以按步长移动
+        block.first_ = reinterpret_cast<ConcretePrototype*>(block.memory_);
+        block.count_ = count;
+        block.stride_ = sizeof(ConcretePrototype);
+        block.destroy_ = &Destroy<ConcretePrototype>;
+        return block;
+    }
+
+    PrototypeBlock(PrototypeBlock&& other) noexcept : PrototypeBlock(){
+        this->Swap(other);
+    }
+    PrototypeBlock& operator=(PrototypeBlock&& other) noexcept{
+        PrototypeBlock released(std::move(other));
+        this->Swap(released);
+        return *this;
+    }
+    PrototypeBlock(const PrototypeBlock&) = delete;
+    PrototypeBlock& operator=(const PrototypeBlock&) = delete;
+    ~PrototypeBlock(){
+        if(memory_ != nullptr){
+            destroy_(memory_, count_);
+            ::operator delete(memory_);
+        }
+    }
+
+    void Swap(PrototypeBlock& other) noexcept{
+        std::swap(memory_, other.memory_);
+        std::swap(first_, other.first_);
+        std::swap(count_, other.count_);
+        std::swap(stride_, other.stride_);
+        std::swap(destroy_, other.destroy_);
+    }
+
+    size_t Size() const { return count_; }
+    Prototype& operator[](size_t i){
+        return *reinterpret_cast<Prototype*>(reinterpret_cast<std::byte*>(first_) + i * stride_);
+    }
+    template<typename Func>
+    void ForEach(Func func){
+        for(size_t i = 0; i < count_; i++){
+            func((*this)[i]);
+        }
+    }
+
+private:
+    template<typename ConcretePrototype>
+    static void Destroy(std::byte* memory, size_t count){
+        for(size_t i = 0; i < count; i++){
+            reinterpret_cast<ConcretePrototype*>(memory + i * sizeof(ConcretePrototype))->~ConcretePrototype();
+        }
     }
 };
 
@@ -45,6 +235,12 @@ public:
     Prototype* Clone() const override{
         return new ConcretePrototype1(*this);
     }
+    Prototype* Clone(PrototypePool& pool) const override{
+        return pool.Create(*this);
+    }
+    PrototypeBlock CloneN(size_t count) const override{
+        return PrototypeBlock::Create(*this, count);
+    }
 };
 
 class ConcretePrototype2 : public Prototype{
@@ -59,6 +255,12 @@ public:
     Prototype* Clone() const override{
         return new ConcretePrototype2(*this);
     }
+    Prototype* Clone(PrototypePool& pool) const override{
+        return pool.Create(*this);
+    }
+    PrototypeBlock CloneN(size_t count) const override{
+        return PrototypeBlock::Create(*this, count);
+    }
 };
 /**
  * 原型工厂
@@ -67,21 +269,45 @@ public:
  */
 class PrototypeFactory{
 private:
-    std::unordered_map<Type, Prototype*, std::hash<int>> prototypes_;
+    // Type是稠密的枚举，直接用它作为下标，查找时不需要计算哈希
+    std::array<std::unique_ptr<Prototype>, MAX_PROTOTYPE_TYPES> prototypes_;
 
 public:
     PrototypeFactory(){
-        prototypes_[Type::PROTOTYPE_1] = new ConcretePrototype1("PROTOTYPE_1", 50.0f);
-        prototypes_[Type::PROTOTYPE_2] = new ConcretePrototype2("PROTOTYPE_2", 60.0f);
+        this->Register(Type::PROTOTYPE_1, std::make_unique<ConcretePrototype1>("PROTOTYPE_1", 50.0f));
+        this->Register(Type::PROTOTYPE_2, std::make_unique<ConcretePrototype2>("PROTOTYPE_2", 60.0f));
     }
 
-    ~PrototypeFactory(){
-        delete prototypes_[Type::PROTOTYPE_1];
-        delete prototypes_[Type::PROTOTYPE_2];
+    // 运行时注册或替换原型，工厂接管其所有权；编号越界时返回false，原型随参数一起释放
+    bool Register(Type type, std::unique_ptr<Prototype> prototype){
+        if(type < 0 || type >= MAX_PROTOTYPE_TYPES){
+            return false;
+        }
+        prototypes_[type] = std::move(prototype);
+        return true;
+    }
+    // 安全查找：未注册或越界的类型返回nullptr，不会插入任何条目
+    Prototype* Find(Type type) const{
+        if(type < 0 || type >= MAX_PROTOTYPE_TYPES){
+            return nullptr;
+        }
+        return prototypes_[type].get();
     }
 
+    // 以下创建方法在类型未注册时分别返回nullptr、空指针和空的PrototypeBlock
     Prototype* CreatePrototype(Type type){
-        return prototypes_[type]->Clone();
+        Prototype* prototype = this->Find(type);
+        return prototype != nullptr ? prototype->Clone() : nullptr;
+    }
+    // 从对象池克隆，名称与原型共享，返回的智能指针析构时自动归还对象池
+    PooledPrototype CreatePrototype(Type type, PrototypePool& pool){
+        Prototype* prototype = this->Find(type);
+        return PooledPrototype(prototype != nullptr ? prototype->Clone(pool) : nullptr, PrototypePool::Deleter{&pool});
+    }
+    // 批量克隆：count个同类型实例放在同一块连续内存中，随返回的PrototypeBlock一起释放
+    PrototypeBlock CloneN(Type type, size_t count){
+        Prototype* prototype = this->Find(type);
+        return prototype != nullptr ? prototype->CloneN(count) : PrototypeBlock();
     }
 };
 
@@ -100,9 +326,137 @@ void Client(PrototypeFactory& prototype_factory){
    delete prototype;
    
 }
+/**
+ * 基准测试：原型名称（代表原型中体积大的不可变部分）从16字节增长到1MB，
+ * 比较深拷贝名称的克隆（之前Clone的做法）、共享名称的堆克隆与共享名称的对象池克隆。
+ */
+template<typename Func>
+double MeasureNsPerCall(size_t calls, Func func){
+    auto start = std::chrono::steady_clock::now();
+    for(size_t i = 0; i < calls; i++){
+        func();
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / calls;
+}
+
+void BenchmarkCloneCost(){
+    PrototypePool pool(std::max(sizeof(ConcretePrototype1), sizeof(ConcretePrototype2)));
+    std::cout << "Benchmark: clone cost by payload size\n";
+    for(size_t payload : {size_t(16), size_t(1024), size_t(64 * 1024), size_t(1024 * 1024)}){
+        ConcretePrototype1 prototype(string(payload, 'p'), 50.0f);
+        size_t calls = std::min<size_t>(100000, (256u << 20) / payload);
+        double deep_ns = MeasureNsPerCall(calls, [&prototype](){
+            delete new ConcretePrototype1(prototype.Name(), 50.0f);
+        });
+        double heap_ns = MeasureNsPerCall(calls, [&prototype](){
+            delete prototype.Clone();
+        });
+        double pool_ns = MeasureNsPerCall(calls, [&prototype, &pool](){
+            pool.Destroy(prototype.Clone(pool));
+        });
+        std::cout << "  " << payload << " B: deep copy " << deep_ns << " ns, shared heap clone " << heap_ns
+                  << " ns, shared pooled clone " << pool_ns << " ns\n";
+    }
+}
+
+/**
+ * 基准测试：遍历count个克隆并调用Update，比较逐个Clone得到的指针与CloneN得到的连续内存块。
+ * 打乱顺序的指针数组模拟堆经过长时间分配释放之后，逐个克隆的对象在内存中散布的情况。
+ */
+void BenchmarkCloneNIteration(PrototypeFactory& prototype_factory, size_t count, size_t rounds){
+    std::vector<Prototype*> individual;
+    individual.reserve(count);
+    for(size_t i = 0; i < count; i++){
+        individual.push_back(prototype_factory.CreatePrototype(Type::PROTOTYPE_1));
+    }
+    std::vector<Prototype*> scattered(individual);
+    std::shuffle(scattered.begin(), scattered.end(), std::mt19937(42));
+    PrototypeBlock block = prototype_factory.CloneN(Type::PROTOTYPE_1, count);
+
+    auto iterate = [rounds](auto&& for_each){
+        return MeasureNsPerCall(rounds, [&for_each](){
+            for_each([](Prototype& prototype){ prototype.Update(prototype.Field() + 1.0f); });
+        });
+    };
+    double individual_ns = iterate([&individual](auto&& func){ for(Prototype* p : individual) func(*p); });
+    double scattered_ns = iterate([&scattered](auto&& func){ for(Prototype* p : scattered) func(*p); });
+    double block_ns = iterate([&block](auto&& func){ block.ForEach(func); });
+    std::cout << "Benchmark: iterating " << count << " clones\n";
+    std::cout << "  cloned pointers          : " << individual_ns / count << " ns/clone\n";
+    std::cout << "  cloned pointers, shuffled: " << scattered_ns / count << " ns/clone\n";
+    std::cout << "  CloneN block             : " << block_ns / count << " ns/clone\n";
+    for(Prototype* prototype : individual){
+        delete prototype;
+    }
+}
+
+/**
+ * 基准测试：按随机类型查找原型，比较原来的unordered_map与按枚举下标访问的数组。
+ */
+void BenchmarkLookup(PrototypeFactory& prototype_factory, size_t lookups){
+    std::unordered_map<Type, Prototype*, std::hash<int>> hashed;
+    std::vector<Type> registered;
+    for(int i = 0; i < MAX_PROTOTYPE_TYPES; i++){
+        Type type = static_cast<Type>(i);
+        if(Prototype* prototype = prototype_factory.Find(type)){
+            hashed[type] = prototype;
+            registered.push_back(type);
+        }
+    }
+    std::vector<Type> keys(4096);
+    std::mt19937 random(7);
+    for(Type& key : keys){
+        key = registered[random() % registered.size()];
+    }
+    size_t index = 0;
+    uintptr_t checksum = 0;
+    double hashed_ns = MeasureNsPerCall(lookups, [&](){
+        checksum += reinterpret_cast<uintptr_t>(hashed.find(keys[index++ & 4095])->second);
+    });
+    index = 0;
+    double flat_ns = MeasureNsPerCall(lookups, [&](){
+        checksum += reinterpret_cast<uintptr_t>(prototype_factory.Find(keys[index++ & 4095]));
+    });
+    std::cout << "Benchmark: " << lookups << " prototype lookups\n";
+    std::cout << "  unordered_map: " << hashed_ns << " ns/lookup\n";
+    std::cout << "  flat array   : " << flat_ns << " ns/lookup\n";
+    std::cout << "  (checksum " << (checksum & 0xffff) << ")\n";
+}
+
 int main(){
     PrototypeFactory* prototype_factory = new PrototypeFactory();
     Client(*prototype_factory);
+    std::cout << '\n';
+
+    std::cout << "Let's create a pooled Prototype 1\n";
+    PrototypePool pool(std::max(sizeof(ConcretePrototype1), sizeof(ConcretePrototype2)));
+    {
+        PooledPrototype prototype = prototype_factory->CreatePrototype(Type::PROTOTYPE_1, pool);
+        prototype->Method(90.0f);
+    }
+    std::cout << '\n';
+
+    std::cout << "Let's create three Prototype 2 in one block\n";
+    PrototypeBlock block = prototype_factory->CloneN(Type::PROTOTYPE_2, 3);
+    float field = 100.0f;
+    block.ForEach([&field](Prototype& prototype){ prototype.Method(field++); });
+    std::cout << '\n';
+
+    std::cout << "Let's register a Prototype 3 at runtime\n";
+    Type prototype_3 = Type::FIRST_RUNTIME_TYPE;
+    if(!prototype_factory->Register(prototype_3, std::make_unique<ConcretePrototype1>("PROTOTYPE_3", 70.0f))){
+        std::cout << "Failed to register Prototype 3\n";
+    }
+    Prototype* prototype = prototype_factory->CreatePrototype(prototype_3);
+    prototype->Method(110.0f);
+    delete prototype;
+    Type unknown = static_cast<Type>(FIRST_RUNTIME_TYPE + 1);
+    std::cout << "Unknown type gives " << (prototype_factory->CreatePrototype(unknown) == nullptr ? "nullptr" : "a prototype") << "\n\n";
+
+    BenchmarkCloneCost();
+    BenchmarkCloneNIteration(*prototype_factory, 1000000, 20);
+    BenchmarkLookup(*prototype_factory, 10000000);
     delete prototype_factory; 
     return 0;
 }
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include <iostream>
+#include <atomic>
 #include <thread>
 /**
  * 单例类定义了GetInstance方法，该方法向客户端隐藏了构造函数，同时允许客户端访问相同的实例。
@@ -8,9 +9,11 @@
  */
 class Singleton{
 protected:
-    Singleton(const std::string value): value_(value) {};
+    Singleton(const std::string value): value_(value) { instances_created_.fetch_add(1); };
     // 静态字段标志单例类是否已经被实例化。
     static Singleton* singleton_;
+    // 记录构造函数被调用的次数，大于1说明发生了重复创建
+    static std::atomic<int> instances_created_;
     std::string value_;
 public:
     Singleton(Singleton& other) = delete;
@@ -18,9 +21,11 @@ public:
     static Singleton* GetInstance(const std::string& value);
     void SomeBusinessLogic() {std::cout << "SomeBusinessLogic" << std::endl;};
     std::string value() const {return value_;};
+    static int instances_created() {return instances_created_.load();};
 };
 
 Singleton* Singleton::singleton_ = nullptr;
+std::atomic<int> Singleton::instances_created_{0};
 /**
  * 静态方法应该在类外定义。
  * GetInstance方法向客户端隐藏了调用私有构造函数的细节。
@@ -57,5 +62,9 @@ int main(){
     std::thread t2(ThreadFoo);
     t1.join();
     t2.join();
+    std::cout << "\nInstances created: " << Singleton::instances_created() << "\n";
+    if (Singleton::instances_created() > 1){
+        std::cout << "Duplicate singleton detected!\n";
+    }
     return 0;
 }
\ No newline at end of file
@@ -1,6 +1,41 @@
 #include <iostream>
-#include <thread>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
 #include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+/**
+ * 带统计的互斥锁：接口与std::mutex相同，可以直接用在lock_guard中。
+ * 先尝试try_lock，只有失败（发生竞争）时才计时，所以无竞争时几乎没有额外开销。
+ * 统计值用于基准测试报告每次调用平均花在等锁上的时间。
+ */
+class InstrumentedMutex{
+private:
+    std::mutex mutex_;
+    std::atomic<uint64_t> wait_ns_{0};
+    std::atomic<uint64_t> contended_{0};
+public:
+    void lock(){
+        if (mutex_.try_lock()){
+            return;
+        }
+        auto start = std::chrono::steady_clock::now();
+        mutex_.lock();
+        auto end = std::chrono::steady_clock::now();
+        wait_ns_.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count(), std::memory_order_relaxed);
+        contended_.fetch_add(1, std::memory_order_relaxed);
+    }
+    bool try_lock() { return mutex_.try_lock(); }
+    void unlock() { mutex_.unlock(); }
+    uint64_t wait_ns() const { return wait_ns_.load(std::memory_order_relaxed); }
+    uint64_t contended() const { return contended_.load(std::memory_order_relaxed); }
+};
 /**
  * 单例类定义了GetInstance方法，该方法向客户端隐藏了构造函数，同时允许客户端访问相同的实例。
  * 单例类的构造函数应该始终是私有的，以防止直接使用new运算符进行构造调用。
@@ -13,9 +48,10 @@
  */
 class Singleton{
 private:
-    static std::mutex mutex_;
+    static InstrumentedMutex mutex_;
     // 静态字段标志单例类是否已经被实例化。
-    static Singleton* singleton_;
+    // 使用原子指针，实例创建完成后读取它不再需要加锁。
+    static std::atomic<Singleton*> singleton_;
 protected:
     Singleton(const std::string value): value_(value) {};
     
@@ -24,29 +60,49 @@ public:
     Singleton(Singleton& other) = delete;
     Singleton& operator=(Singleton& other) = delete;
     static Singleton* GetInstance(const std::string& value);
+    // 每次调用都加锁的版本，仅用于和GetInstance对比
+    static Singleton* GetInstanceLocked(const std::string& value);
     void SomeBusinessLogic() {std::cout << "SomeBusinessLogic" << std::endl;};
     std::string value() const {return value_;};
+    static const InstrumentedMutex& mutex() {return mutex_;};
 };
 
-Singleton* Singleton::singleton_ = nullptr;
-std::mutex Singleton::mutex_;
+std::atomic<Singleton*> Singleton::singleton_{nullptr};
+InstrumentedMutex Singleton::mutex_;
 /**
  * 静态方法应该在类外定义。
  * GetInstance方法向客户端隐藏了调用私有构造函数的细节。
  * 让客户端能够访问相同的实例。
  * 返回静态字段
  */
- // 该方法是线程安全的，因为它使用了互斥锁来保护对静态字段的访问。
+ // 该方法是线程安全的，它使用双重检查锁定：
+ // 实例已经存在时只做一次acquire语义的原子读取，不加锁；
+ // 只有实例尚未创建时才加锁，并在锁内再检查一次，避免重复创建。
+ // release语义的写入保证其他线程读到指针时，也能看到构造完成的对象。
 Singleton* Singleton::GetInstance(const std::string &value){
+    Singleton* instance = singleton_.load(std::memory_order_acquire);
+    if (instance == nullptr){
+        std::lock_guard<InstrumentedMutex> lock(mutex_);
+        instance = singleton_.load(std::memory_order_relaxed);
+        if (instance == nullptr){
+            instance = new Singleton(value);
+            singleton_.store(instance, std::memory_order_release);
+        }
+    }
+    return instance;
+}
+ // 该方法是线程安全的，因为它使用了互斥锁来保护对静态字段的访问，但每次调用都要加锁。
+Singleton* Singleton::GetInstanceLocked(const std::string &value){
     // 使用整个类的互斥锁来保护对静态字段的访问。
     // 这确保了只有一个线程可以访问静态字段。
     // lock_guard是一个RAII类，它在构造函数中获取互斥锁，并在析构函数中释放互斥锁。
     // 出作用域后，lock_guard会自动释放互斥锁。
-    std::lock_guard<std::mutex> lock(mutex_);
-    if (singleton_ == nullptr){
-        singleton_ = new Singleton(value);
+    std::lock_guard<InstrumentedMutex> lock(mutex_);
+    if (singleton_.load(std::memory_order_relaxed) == nullptr){
+        // GetInstance会不加锁地读取这个指针，所以同样要用release发布
+        singleton_.store(new Singleton(value), std::memory_order_release);
     }
-    return singleton_;
+    return singleton_.load(std::memory_order_relaxed);
 }
 
 void ThreadFoo(){
@@ -61,7 +117,246 @@ void ThreadBar(){
     std::cout << singleton->value() << std::endl; 
 }
 
-int main(){
+/**
+ * 以下两个类是05和07中单例策略的精简版本，只用于在同一个程序里对比访问开销。
+ * 它们额外记录构造次数，并提供重置接口，用于检测冷启动时是否创建了多个实例。
+ */
+class NaiveSingleton{
+private:
+    static NaiveSingleton* singleton_;
+    static std::atomic<unsigned> constructions_;
+    std::string value_;
+    NaiveSingleton(const std::string& value) : value_(value) { constructions_.fetch_add(1); }
+public:
+    // 不是线程安全的，多个线程同时第一次调用时可能各自创建一个实例
+    static NaiveSingleton* GetInstance(const std::string& value){
+        if (singleton_ == nullptr){
+            singleton_ = new NaiveSingleton(value);
+        }
+        return singleton_;
+    }
+    const std::string& value() const { return value_; }
+    static unsigned constructions() { return constructions_.load(); }
+    // 仅用于基准测试：丢弃当前实例（重复创建的实例已经无法追踪，只能泄漏）
+    static void ResetForBenchmark(){
+        delete singleton_;
+        singleton_ = nullptr;
+        constructions_.store(0);
+    }
+};
+NaiveSingleton* NaiveSingleton::singleton_ = nullptr;
+std::atomic<unsigned> NaiveSingleton::constructions_{0};
+
+class MagicSingleton{
+private:
+    std::string value_;
+    explicit MagicSingleton(const std::string& value) : value_(value) {}
+public:
+    static MagicSingleton& GetInstance(const std::string& value){
+        static MagicSingleton instance(value);
+        return instance;
+    }
+    const std::string& value() const { return value_; }
+};
+
+/**
+ * 基准测试配置，可以通过命令行参数修改：
+ *   --threads=1,2,4,...   参与竞争的线程数列表
+ *   --calls=N             每个线程的调用次数
+ *   --rate=N              每个线程每秒的目标调用次数，0表示不限速
+ *   --trials=N            冷启动重复实例检测的试验次数
+ */
+struct BenchmarkConfig{
+    std::vector<unsigned> thread_counts{1, 2, 4, 8, 16, 32, 64};
+    size_t calls = 100000;
+    double rate = 0;
+    unsigned trials = 20;
+
+    static BenchmarkConfig Parse(int argc, char* argv[]){
+        BenchmarkConfig config;
+        for (int i = 1; i < argc; i++){
+            std::string arg = argv[i];
+            auto value_of = [&arg](const std::string& prefix){ return arg.substr(prefix.size()); };
+            if (arg.rfind("--threads=", 0) == 0){
+                config.thread_counts.clear();
+                std::stringstream list(value_of("--threads="));
+                std::string item;
+                while (std::getline(list, item, ',')){
+                    config.thread_counts.push_back(static_cast<unsigned>(std::max(1, std::atoi(item.c_str()))));
+                }
+            }else if (arg.rfind("--calls=", 0) == 0){
+                config.calls = std::strtoull(value_of("--calls=").c_str(), nullptr, 10);
+            }else if (arg.rfind("--rate=", 0) == 0){
+                config.rate = std::atof(value_of("--rate=").c_str());
+            }else if (arg.rfind("--trials=", 0) == 0){
+                config.trials = static_cast<unsigned>(std::atoi(value_of("--trials=").c_str()));
+            }
+        }
+        return config;
+    }
+};
+
+struct ContentionResult{
+    double mean_ns;
+    double p99_ns;
+};
+
+// 防止编译器把基准测试中的调用优化掉
+std::atomic<size_t> benchmark_sink{0};
+
+/**
+ * threads个线程同时调用calls次访问函数，所有线程在同一时刻开始。
+ * 单次调用只有几纳秒，比读时钟本身还快，所以每kBatch次调用计一次时，
+ * 以批次的平均值作为一个延迟样本，p99取所有线程样本的第99百分位。
+ * 设置了调用速率时，每个批次结束后等待到计划时间再继续。
+ */
+template<typename Access>
+ContentionResult MeasureContention(unsigned threads, const BenchmarkConfig& config, Access access){
+    const size_t kBatch = 16;
+    std::atomic<bool> go{false};
+    std::atomic<unsigned> ready{0};
+    std::vector<double> elapsed_ns(threads);
+    std::vector<std::vector<float>> samples(threads);
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threads; t++){
+        workers.emplace_back([&, t](){
+            std::vector<float>& local_samples = samples[t];
+            local_samples.reserve(config.calls / kBatch + 1);
+            ready.fetch_add(1);
+            while (!go.load(std::memory_order_acquire)){
+                std::this_thread::yield();
+            }
+            size_t checksum = 0;
+            double busy_ns = 0;
+            auto start = std::chrono::steady_clock::now();
+            for (size_t done = 0; done < config.calls; done += kBatch){
+                size_t batch = std::min(kBatch, config.calls - done);
+                auto batch_start = std::chrono::steady_clock::now();
+                for (size_t i = 0; i < batch; i++){
+                    checksum += reinterpret_cast<uintptr_t>(access());
+                }
+                auto batch_end = std::chrono::steady_clock::now();
+                double batch_ns = std::chrono::duration<double, std::nano>(batch_end - batch_start).count();
+                busy_ns += batch_ns;
+                local_samples.push_back(static_cast<float>(batch_ns / batch));
+                if (config.rate > 0){
+                    auto due = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                        std::chrono::duration<double>((done + batch) / config.rate));
+                    while (std::chrono::steady_clock::now() < due){
+                        std::this_thread::yield();
+                    }
+                }
+            }
+            elapsed_ns[t] = busy_ns;
+            benchmark_sink.fetch_add(checksum, std::memory_order_relaxed);
+        });
+    }
+    while (ready.load() != threads){
+        std::this_thread::yield();
+    }
+    go.store(true, std::memory_order_release);
+    for (std::thread& worker : workers){
+        worker.join();
+    }
+    double total = 0;
+    std::vector<float> all_samples;
+    for (unsigned t = 0; t < threads; t++){
+        total += elapsed_ns[t];
+        all_samples.insert(all_samples.end(), samples[t].begin(), samples[t].end());
+    }
+    size_t p99_index = all_samples.empty() ? 0 : (all_samples.size() - 1) * 99 / 100;
+    std::nth_element(all_samples.begin(), all_samples.begin() + p99_index, all_samples.end());
+    double p99 = all_samples.empty() ? 0 : all_samples[p99_index];
+    return ContentionResult{total / threads / config.calls, p99};
+}
+
+/**
+ * 运行一个单例策略的全部线程数配置并输出一张表。
+ * mutex不为空时，额外报告每次调用的平均等锁时间和发生竞争的调用比例。
+ * 新的单例策略只需要再调用一次本函数。
+ */
+template<typename Access>
+void RunVariant(const char* name, const BenchmarkConfig& config, const InstrumentedMutex* mutex, Access access){
+    std::cout << name << "\n";
+    std::cout << std::setw(9) << "threads" << std::setw(12) << "ns/call" << std::setw(12) << "p99 ns"
+              << std::setw(16) << "lock wait ns" << std::setw(12) << "contended" << "\n";
+    for (unsigned threads : config.thread_counts){
+        uint64_t wait_before = mutex != nullptr ? mutex->wait_ns() : 0;
+        uint64_t contended_before = mutex != nullptr ? mutex->contended() : 0;
+        ContentionResult result = MeasureContention(threads, config, access);
+        std::cout << std::setw(9) << threads << std::setw(12) << result.mean_ns << std::setw(12) << result.p99_ns;
+        if (mutex != nullptr){
+            double calls = static_cast<double>(config.calls) * threads;
+            std::cout << std::setw(16) << (mutex->wait_ns() - wait_before) / calls
+                      << std::setw(11) << (mutex->contended() - contended_before) * 100.0 / calls << "%";
+        }else{
+            std::cout << std::setw(16) << "-" << std::setw(12) << "-";
+        }
+        std::cout << "\n";
+    }
+}
+
+/**
+ * 冷启动竞争：重置朴素单例后让threads个线程同时第一次调用GetInstance，
+ * 统计有多少次试验创建了不止一个实例。
+ */
+void DetectNaiveDuplicates(const BenchmarkConfig& config){
+    std::cout << "Naive singleton (05) cold-start race, " << config.trials << " trials per thread count\n";
+    for (unsigned threads : config.thread_counts){
+        if (threads < 2){
+            continue;
+        }
+        unsigned duplicated_trials = 0;
+        unsigned max_instances = 1;
+        for (unsigned trial = 0; trial < config.trials; trial++){
+            NaiveSingleton::ResetForBenchmark();
+            std::atomic<bool> go{false};
+            std::atomic<unsigned> ready{0};
+            std::vector<std::thread> workers;
+            for (unsigned t = 0; t < threads; t++){
+                workers.emplace_back([&](){
+                    ready.fetch_add(1);
+                    while (!go.load(std::memory_order_acquire)){}
+                    NaiveSingleton::GetInstance("RACE");
+                });
+            }
+            while (ready.load() != threads){
+                std::this_thread::yield();
+            }
+            go.store(true, std::memory_order_release);
+            for (std::thread& worker : workers){
+                worker.join();
+            }
+            unsigned instances = NaiveSingleton::constructions();
+            if (instances > 1){
+                duplicated_trials++;
+                max_instances = std::max(max_instances, instances);
+            }
+        }
+        std::cout << std::setw(9) << threads << " threads: duplicates in " << duplicated_trials << " trials"
+                  << ", at most " << max_instances << " instances\n";
+    }
+}
+
+void BenchmarkSingletonAccess(const BenchmarkConfig& config){
+    const std::string value = "BENCH";
+    std::cout << "Benchmark: steady-state GetInstance, " << config.calls << " calls per thread";
+    if (config.rate > 0){
+        std::cout << " at " << config.rate << " calls/s per thread";
+    }
+    std::cout << "\n";
+    // 先创建好所有实例，之后只测量稳定状态下的访问路径
+    NaiveSingleton::GetInstance(value);
+    Singleton::GetInstance(value);
+    MagicSingleton::GetInstance(value);
+    RunVariant("naive (05)", config, nullptr, [&value](){ return NaiveSingleton::GetInstance(value); });
+    RunVariant("mutex (06)", config, &Singleton::mutex(), [&value](){ return Singleton::GetInstanceLocked(value); });
+    RunVariant("atomic fast path (06)", config, &Singleton::mutex(), [&value](){ return Singleton::GetInstance(value); });
+    RunVariant("magic static (07)", config, nullptr, [&value](){ return &MagicSingleton::GetInstance(value); });
+    DetectNaiveDuplicates(config);
+}
+
+int main(int argc, char* argv[]){
     std::cout << "If you see the same value, then singleton was reused (yay!\n" <<
                 "If you see different values, then 2 singletons were created (booo!!)\n\n" <<
                 "RESULT:\n"; 
@@ -69,5 +364,7 @@ int main(){
     std::thread t2(ThreadFoo);
     t1.join();
     t2.join();
+    std::cout << "\n";
+    BenchmarkSingletonAccess(BenchmarkConfig::Parse(argc, argv));
     return 0;
 }
\ No newline at end of file
@@ -1,5 +1,18 @@
 #include <iostream>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
 #include <string>
+#include <thread>
+#include <typeindex>
+#include <vector>
 
 class MagicSingleton {
 public:
@@ -36,12 +49,352 @@ private:
     }
 };
 
+/**
+ * 所有线程共同修改同一组计数器的单例。
+ * 计数器本身是原子的，结果正确，但每次写入都要独占同一条缓存行，多线程写入时缓存行在核心之间来回传递。
+ */
+class SharedCounterSingleton {
+public:
+    static SharedCounterSingleton& GetInstance() {
+        static SharedCounterSingleton instance;
+        return instance;
+    }
+    void Record(uint64_t bytes) {
+        requests_.fetch_add(1, std::memory_order_relaxed);
+        bytes_.fetch_add(bytes, std::memory_order_relaxed);
+    }
+    uint64_t requests() const { return requests_.load(std::memory_order_relaxed); }
+    uint64_t bytes() const { return bytes_.load(std::memory_order_relaxed); }
+
+    SharedCounterSingleton(const SharedCounterSingleton&) = delete;
+    SharedCounterSingleton& operator=(const SharedCounterSingleton&) = delete;
+
+private:
+    SharedCounterSingleton() = default;
+    std::atomic<uint64_t> requests_{0};
+    std::atomic<uint64_t> bytes_{0};
+};
+
+/**
+ * 分片单例：单例本身仍然由静态局部变量保证只初始化一次，
+ * 但内部的可变状态按线程拆成多个分片，每个分片独占一条缓存行。
+ * 线程第一次访问时领取一个分片编号，之后只写自己的分片，写入不会和其他线程争用缓存行。
+ * 线程数超过分片数时多个线程共享分片，所以分片内的计数器仍然是原子的（无竞争时开销很小）。
+ * 读取时遍历所有分片合并成一个汇总视图，读比写慢，适合写多读少的计数器和统计信息。
+ */
+class ShardedCounterSingleton {
+public:
+    // 常见CPU的缓存行大小
+    static constexpr size_t kCacheLineSize = 64;
+    static constexpr size_t kShardCount = 64;
+
+    struct alignas(kCacheLineSize) Shard {
+        std::atomic<uint64_t> requests{0};
+        std::atomic<uint64_t> bytes{0};
+    };
+    // 合并后的汇总视图
+    struct Snapshot {
+        uint64_t requests = 0;
+        uint64_t bytes = 0;
+    };
+
+    static ShardedCounterSingleton& GetInstance() {
+        static ShardedCounterSingleton instance;
+        return instance;
+    }
+
+    void Record(uint64_t bytes) {
+        Shard& shard = this->LocalShard();
+        shard.requests.fetch_add(1, std::memory_order_relaxed);
+        shard.bytes.fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    Snapshot Aggregate() const {
+        Snapshot snapshot;
+        for (const Shard& shard : shards_) {
+            snapshot.requests += shard.requests.load(std::memory_order_relaxed);
+            snapshot.bytes += shard.bytes.load(std::memory_order_relaxed);
+        }
+        return snapshot;
+    }
+
+    ShardedCounterSingleton(const ShardedCounterSingleton&) = delete;
+    ShardedCounterSingleton& operator=(const ShardedCounterSingleton&) = delete;
+
+private:
+    ShardedCounterSingleton() = default;
+
+    Shard& LocalShard() {
+        thread_local size_t index = next_shard_.fetch_add(1, std::memory_order_relaxed) % kShardCount;
+        return shards_[index];
+    }
+
+    std::array<Shard, kShardCount> shards_;
+    std::atomic<size_t> next_shard_{0};
+};
+
+/**
+ * 基准测试：1到N个线程各自写入writes次计数器，比较共享计数器与分片计数器的总吞吐量。
+ * 线性扩展时，吞吐量应当随线程数成比例增长。
+ */
+template<typename Work>
+double MeasureThreadsMs(unsigned threads, Work work) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < threads; i++) {
+        workers.emplace_back(work);
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void BenchmarkShardedWrites(size_t writes) {
+    unsigned max_threads = std::max(2u, std::thread::hardware_concurrency());
+    std::cout << "Benchmark: " << writes << " counter writes per thread\n";
+    for (unsigned threads = 1; threads <= max_threads; threads *= 2) {
+        double shared_ms = MeasureThreadsMs(threads, [writes]() {
+            SharedCounterSingleton& stats = SharedCounterSingleton::GetInstance();
+            for (size_t i = 0; i < writes; i++) {
+                stats.Record(i & 1023);
+            }
+        });
+        double sharded_ms = MeasureThreadsMs(threads, [writes]() {
+            ShardedCounterSingleton& stats = ShardedCounterSingleton::GetInstance();
+            for (size_t i = 0; i < writes; i++) {
+                stats.Record(i & 1023);
+            }
+        });
+        double total = static_cast<double>(writes) * threads;
+        std::cout << "  " << threads << " thread(s): shared " << total / shared_ms / 1000.0
+                  << " Mwrites/s, sharded " << total / sharded_ms / 1000.0 << " Mwrites/s\n";
+    }
+    ShardedCounterSingleton::Snapshot snapshot = ShardedCounterSingleton::GetInstance().Aggregate();
+    std::cout << "  totals: shared " << SharedCounterSingleton::GetInstance().requests() << " requests / "
+              << SharedCounterSingleton::GetInstance().bytes() << " bytes, sharded " << snapshot.requests
+              << " requests / " << snapshot.bytes << " bytes\n";
+}
+
+/**
+ * 单例生命周期管理器：解决05/06中单例从不释放、07中静态对象跨翻译单元析构顺序未定义的问题。
+ * 1. 启动阶段（单线程）用Register登记每个单例的名称、依赖和创建函数。
+ * 2. 之后可以用Get按需惰性创建，也可以用WarmUp在启动时按依赖层级并行地一次性创建全部单例。
+ *    同一层级中的单例互不依赖，由多个线程同时创建；依赖总是先于使用者创建完成。
+ * 3. Shutdown按创建顺序的逆序销毁，保证使用者总是先于它的依赖被销毁。
+ * 每个单例的初始化耗时（不含其依赖）都会被记录下来，可以用PrintInitReport输出。
+ */
+class SingletonLifetimeManager {
+public:
+    static SingletonLifetimeManager& GetInstance() {
+        static SingletonLifetimeManager instance;
+        return instance;
+    }
+
+    template<typename T, typename Factory>
+    void Register(const std::string& name, std::vector<std::string> dependencies, Factory factory) {
+        // 依赖图只在第一次Get或WarmUp时检查一次，之后再登记就可能绕过循环检测
+        if (validated_flag_.load(std::memory_order_acquire)) {
+            throw std::logic_error("SingletonLifetimeManager: register " + name + " after first use");
+        }
+        std::unique_ptr<Entry> entry(new Entry());
+        entry->name = name;
+        entry->type = std::type_index(typeid(T));
+        entry->dependencies = std::move(dependencies);
+        // 先转换成T*再转成void*，与Get、destroy中的static_cast<T*>对应，工厂返回派生类指针时也正确
+        entry->create = [factory]() -> void* { return static_cast<void*>(static_cast<T*>(factory())); };
+        entry->destroy = [](void* instance) { delete static_cast<T*>(instance); };
+        if (!entries_.emplace(name, std::move(entry)).second) {
+            throw std::logic_error("SingletonLifetimeManager: duplicate singleton " + name);
+        }
+    }
+
+    // 惰性获取：第一次访问时先创建全部依赖，再创建自己；并发访问时只会创建一次
+    template<typename T>
+    T& Get(const std::string& name) {
+        Entry& entry = this->Find(name);
+        if (entry.type != std::type_index(typeid(T))) {
+            throw std::logic_error("SingletonLifetimeManager: type mismatch for " + name);
+        }
+        this->Ensure(entry);
+        if (entry.instance == nullptr) {
+            throw std::logic_error("SingletonLifetimeManager: " + name + " accessed after Shutdown");
+        }
+        return *static_cast<T*>(entry.instance);
+    }
+
+    // 启动时预热：按依赖层级分批，每一批用threads个线程并行创建
+    void WarmUp(unsigned threads) {
+        std::vector<std::vector<Entry*>> levels = this->Levels();
+        for (const std::vector<Entry*>& level : levels) {
+            std::atomic<size_t> next{0};
+            auto worker = [this, &level, &next]() {
+                for (size_t i = next.fetch_add(1); i < level.size(); i = next.fetch_add(1)) {
+                    this->Ensure(*level[i]);
+                }
+            };
+            std::vector<std::thread> workers;
+            for (unsigned t = 1; t < threads && t < level.size(); t++) {
+                workers.emplace_back(worker);
+            }
+            worker();
+            for (std::thread& thread : workers) {
+                thread.join();
+            }
+        }
+    }
+
+    // 按创建顺序的逆序销毁所有已创建的单例，之后不能再访问它们
+    void Shutdown() {
+        std::lock_guard<std::mutex> lock(order_mutex_);
+        for (auto it = creation_order_.rbegin(); it != creation_order_.rend(); ++it) {
+            (*it)->destroy((*it)->instance);
+            (*it)->instance = nullptr;
+        }
+        creation_order_.clear();
+    }
+
+    void PrintInitReport() const {
+        std::lock_guard<std::mutex> lock(order_mutex_);
+        std::cout << "Singleton initialization report (creation order):\n";
+        for (const Entry* entry : creation_order_) {
+            std::cout << "  " << entry->name << ": " << entry->init_ms << " ms\n";
+        }
+    }
+
+    SingletonLifetimeManager(const SingletonLifetimeManager&) = delete;
+    SingletonLifetimeManager& operator=(const SingletonLifetimeManager&) = delete;
+
+private:
+    struct Entry {
+        std::string name;
+        std::type_index type = std::type_index(typeid(void));
+        std::vector<std::string> dependencies;
+        std::function<void*()> create;
+        void (*destroy)(void*) = nullptr;
+        void* instance = nullptr;
+        std::once_flag once;
+        double init_ms = 0;
+    };
+
+    SingletonLifetimeManager() = default;
+    // 静态析构时兜底，正常情况下应当由程序显式调用Shutdown
+    ~SingletonLifetimeManager() { this->Shutdown(); }
+
+    Entry& Find(const std::string& name) {
+        auto it = entries_.find(name);
+        if (it == entries_.end()) {
+            throw std::logic_error("SingletonLifetimeManager: unknown singleton " + name);
+        }
+        return *it->second;
+    }
+
+    void Ensure(Entry& entry) {
+        std::call_once(validated_, [this]() {
+            this->Levels();
+            validated_flag_.store(true, std::memory_order_release);
+        });
+        std::call_once(entry.once, [this, &entry]() {
+            for (const std::string& dependency : entry.dependencies) {
+                this->Ensure(this->Find(dependency));
+            }
+            auto start = std::chrono::steady_clock::now();
+            entry.instance = entry.create();
+            entry.init_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            std::lock_guard<std::mutex> lock(order_mutex_);
+            creation_order_.push_back(&entry);
+        });
+    }
+
+    // 计算每个单例的依赖深度并按深度分层，同时检查未登记的依赖和循环依赖
+    std::vector<std::vector<Entry*>> Levels() {
+        std::map<const Entry*, int> depth;
+        std::function<int(Entry&)> visit = [&](Entry& entry) -> int {
+            auto it = depth.find(&entry);
+            if (it != depth.end()) {
+                if (it->second < 0) {
+                    throw std::logic_error("SingletonLifetimeManager: dependency cycle at " + entry.name);
+                }
+                return it->second;
+            }
+            depth[&entry] = -1;
+            int level = 0;
+            for (const std::string& dependency : entry.dependencies) {
+                level = std::max(level, visit(this->Find(dependency)) + 1);
+            }
+            depth[&entry] = level;
+            return level;
+        };
+        std::vector<std::vector<Entry*>> levels;
+        for (auto& pair : entries_) {
+            size_t level = static_cast<size_t>(visit(*pair.second));
+            if (levels.size() <= level) {
+                levels.resize(level + 1);
+            }
+            levels[level].push_back(pair.second.get());
+        }
+        return levels;
+    }
+
+    std::map<std::string, std::unique_ptr<Entry>> entries_;
+    std::once_flag validated_;
+    std::atomic<bool> validated_flag_{false};
+    mutable std::mutex order_mutex_;
+    std::vector<Entry*> creation_order_;
+};
+
+/**
+ * 演示用的受管单例：构造时模拟一段初始化耗时，析构时打印名称以展示销毁顺序。
+ */
+class ManagedService {
+public:
+    ManagedService(const std::string& name, int init_ms) : name_(name) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(init_ms));
+    }
+    ~ManagedService() {
+        std::cout << "  " << name_ << " destroyed\n";
+    }
+private:
+    std::string name_;
+};
+
+void LifetimeManagerDemo() {
+    SingletonLifetimeManager& manager = SingletonLifetimeManager::GetInstance();
+    manager.Register<ManagedService>("Config", {}, []() { return new ManagedService("Config", 20); });
+    manager.Register<ManagedService>("Logger", {"Config"}, []() { return new ManagedService("Logger", 30); });
+    manager.Register<ManagedService>("Cache", {"Config"}, []() { return new ManagedService("Cache", 40); });
+    manager.Register<ManagedService>("Database", {"Config", "Logger"}, []() { return new ManagedService("Database", 50); });
+
+    auto start = std::chrono::steady_clock::now();
+    manager.WarmUp(4);
+    double warm_up_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    manager.PrintInitReport();
+    std::cout << "Parallel warm-up took " << warm_up_ms << " ms\n";
+
+    manager.Get<ManagedService>("Database");
+    std::cout << "Shutting down in reverse dependency order:\n";
+    manager.Shutdown();
+
+    try {
+        manager.Get<ManagedService>("Database");
+    } catch (const std::logic_error& error) {
+        std::cout << error.what() << "\n";
+    }
+    try {
+        manager.Register<ManagedService>("Metrics", {"Logger"}, []() { return new ManagedService("Metrics", 10); });
+    } catch (const std::logic_error& error) {
+        std::cout << error.what() << "\n";
+    }
+}
+
 int main() {
     auto& s1 = MagicSingleton::GetInstance("First");
     auto& s2 = MagicSingleton::GetInstance("Second"); // 这行不会重新初始化
     
     s1.PrintValue(); // 输出 "First"
     s2.PrintValue(); // 同样输出 "First"
-    
+
+    BenchmarkShardedWrites(5000000);
+    LifetimeManagerDemo();
     return 0;
 }
\ No newline at end of file
@@ -1,5 +1,20 @@
 #include <iostream>
 #include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <iomanip>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <vector>
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
 /**
  * Target类定义了客户端代码所期望的接口。
  */
@@ -17,10 +32,96 @@ public:
  * 因此，Adaptee需要进行一些调整才能与客户端代码一起使用。
  */
 class Adaptee {
+private:
+    std::string specific_data_;
 public:
+    Adaptee() : specific_data_(".eetpadA eht fo roivaheb laicepS") {}
+    explicit Adaptee(std::string specific_data) : specific_data_(std::move(specific_data)) {}
     std::string SpecificRequest() const {
-        return ".eetpadA eht fo roivaheb laicepS";
-    }	
+        return specific_data_;
+    }
+    // 不拷贝的版本：直接暴露Adaptee内部的数据
+    std::string_view SpecificRequestView() const {
+        return specific_data_;
+    }
+};
+
+/**
+ * 字节反转内核：dst[i] = src[n - 1 - i]，src与dst不能重叠。
+ * 每次处理16字节：按指令集选择SSSE3的pshufb、SSE2的移位与混洗组合或NEON的vrev，
+ * 都不可用时退化为逐字节拷贝；不足16字节的尾部逐字节处理。
+ */
+void ReverseCopy(const char* src, size_t n, char* dst) {
+    size_t i = 0;
+#if defined(__SSSE3__)
+    const __m128i mask = _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+    for (; i + 16 <= n; i += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + n - i - 16));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_shuffle_epi8(block, mask));
+    }
+#elif defined(__SSE2__) || defined(_M_X64)
+    for (; i + 16 <= n; i += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + n - i - 16));
+        block = _mm_shuffle_epi32(block, _MM_SHUFFLE(0, 1, 2, 3));
+        block = _mm_shufflelo_epi16(block, _MM_SHUFFLE(2, 3, 0, 1));
+        block = _mm_shufflehi_epi16(block, _MM_SHUFFLE(2, 3, 0, 1));
+        block = _mm_or_si128(_mm_slli_epi16(block, 8), _mm_srli_epi16(block, 8));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), block);
+    }
+#elif defined(__ARM_NEON)
+    for (; i + 16 <= n; i += 16) {
+        uint8x16_t block = vrev64q_u8(vld1q_u8(reinterpret_cast<const uint8_t*>(src + n - i - 16)));
+        vst1q_u8(reinterpret_cast<uint8_t*>(dst + i), vcombine_u8(vget_high_u8(block), vget_low_u8(block)));
+    }
+#endif
+    for (; i < n; i++) {
+        dst[i] = src[n - 1 - i];
+    }
+}
+
+/**
+ * 反向视图：不拷贝也不修改底层数据，按相反的顺序访问一个string_view。
+ * 需要逐字节读取的使用者直接遍历视图即可；需要连续字节时才调用CopyTo物化。
+ */
+class ReversedView {
+private:
+    std::string_view data_;
+public:
+    using const_iterator = std::string_view::const_reverse_iterator;
+
+    explicit ReversedView(std::string_view data) : data_(data) {}
+    size_t size() const { return data_.size(); }
+    char operator[](size_t i) const { return data_[data_.size() - 1 - i]; }
+    const_iterator begin() const { return data_.rbegin(); }
+    const_iterator end() const { return data_.rend(); }
+    // 物化到dst，dst至少要有size()字节
+    void CopyTo(char* dst) const { ReverseCopy(data_.data(), data_.size(), dst); }
+};
+
+/**
+ * 惰性的适配结果：由固定前缀和Adaptee数据的反向视图组成，构造时不分配任何内存。
+ */
+class AdaptedRequest {
+private:
+    std::string_view prefix_;
+    ReversedView body_;
+public:
+    AdaptedRequest(std::string_view prefix, ReversedView body) : prefix_(prefix), body_(body) {}
+    std::string_view prefix() const { return prefix_; }
+    const ReversedView& body() const { return body_; }
+    size_t size() const { return prefix_.size() + body_.size(); }
+    // 追加到调用者提供的缓冲区，缓冲区容量足够时不产生分配
+    void AppendTo(std::string& out) const {
+        size_t offset = out.size();
+        out.resize(offset + this->size());
+        std::memcpy(&out[offset], prefix_.data(), prefix_.size());
+        body_.CopyTo(&out[offset + prefix_.size()]);
+    }
+    std::string str() const {
+        std::string out;
+        this->AppendTo(out);
+        return out;
+    }
 };
 /**
  * Adapter类使Adaptee的接口与Target的接口兼容。
@@ -38,12 +139,165 @@ public:
         std::reverse(to_reverse.begin(), to_reverse.end());
         return "Adapter: (TRANSLATED) " + to_reverse;
     }
+    // 零拷贝版本：返回惰性的适配结果，直到使用者需要字节时才物化
+    AdaptedRequest RequestView() const {
+        return AdaptedRequest("Adapter: (TRANSLATED) ", ReversedView(this->adaptee_->SpecificRequestView()));
+    }
+};
+
+/**
+ * 批量翻译的输出区：所有记录的字节连续存放在同一块缓冲区里，ends_记录每条记录的结束位置。
+ * Prepare按总字节数一次性调整输出区大小，容量在多次使用之间保留，反复使用时不再分配。
+ */
+class TranslatedBatch {
+private:
+    std::string arena_;
+    std::vector<size_t> ends_;
+public:
+    // 把输出区调整为bytes字节并返回起始位置，之后用AddRecord按顺序登记每条记录的结束位置
+    char* Prepare(size_t bytes, size_t records) {
+        arena_.resize(bytes);
+        ends_.clear();
+        ends_.reserve(records);
+        return &arena_[0];
+    }
+    void AddRecord(size_t end) {
+        ends_.push_back(end);
+    }
+    size_t size() const { return ends_.size(); }
+    std::string_view operator[](size_t i) const {
+        size_t begin = i == 0 ? 0 : ends_[i - 1];
+        return std::string_view(arena_.data() + begin, ends_[i] - begin);
+    }
+};
+
+/**
+ * 批量目标接口：一次虚函数调用处理一整批记录，虚分派被提到循环之外。
+ */
+class BatchTarget {
+public:
+    virtual ~BatchTarget() = default;
+    virtual void RequestBatch(const std::string_view* adaptee_outputs, size_t count, TranslatedBatch& out) const = 0;
+};
+
+/**
+ * 批量适配器：先计算整批输出的总大小并预留输出区，再一次遍历完成全部翻译，
+ * 每条记录写入前缀后直接用反转内核把Adaptee的数据反向拷贝到输出区。
+ */
+class BatchAdapter : public BatchTarget {
+public:
+    void RequestBatch(const std::string_view* adaptee_outputs, size_t count, TranslatedBatch& out) const override {
+        static constexpr std::string_view kPrefix = "Adapter: (TRANSLATED) ";
+        size_t total = 0;
+        for (size_t i = 0; i < count; i++) {
+            total += kPrefix.size() + adaptee_outputs[i].size();
+        }
+        char* base = out.Prepare(total, count);
+        size_t offset = 0;
+        for (size_t i = 0; i < count; i++) {
+            std::memcpy(base + offset, kPrefix.data(), kPrefix.size());
+            offset += kPrefix.size();
+            ReverseCopy(adaptee_outputs[i].data(), adaptee_outputs[i].size(), base + offset);
+            offset += adaptee_outputs[i].size();
+            out.AddRecord(offset);
+        }
+    }
 };
 
 void Client(const Target* target){
     std::cout << target->Request();
 }
 
+/**
+ * 基准测试：载荷从16字节增长到1MB，比较原来的Request（拷贝、原地反转、拼接）、
+ * 逐字节扫描反向视图而不物化（例如统计字符的使用者）、
+ * 以及物化到可复用缓冲区（标量反向拷贝与SIMD内核）。
+ */
+template<typename Func>
+double MeasureNsPerCall(size_t calls, Func func) {
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < calls; i++) {
+        func();
+    }
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / calls;
+}
+
+void BenchmarkAdapterPayloads() {
+    std::cout << "Benchmark: ns per request by payload size\n";
+    std::cout << std::setw(10) << "payload" << std::setw(14) << "Request" << std::setw(14) << "lazy scan"
+              << std::setw(14) << "scalar copy" << std::setw(14) << "SIMD copy" << "\n";
+    size_t checksum = 0;
+    std::string buffer;
+    for (size_t payload : {size_t(16), size_t(256), size_t(4096), size_t(65536), size_t(1) << 20}) {
+        std::string data(payload, ' ');
+        for (size_t i = 0; i < payload; i++) {
+            data[i] = static_cast<char>('a' + i % 26);
+        }
+        Adaptee adaptee(data);
+        Adapter adapter(&adaptee);
+        size_t calls = std::max<size_t>(200, (64u << 20) / payload);
+        double legacy_ns = MeasureNsPerCall(calls, [&]() {
+            checksum += adapter.Request().size();
+        });
+        double view_ns = MeasureNsPerCall(calls, [&]() {
+            AdaptedRequest request = adapter.RequestView();
+            checksum += request.prefix().size() + std::count(request.body().begin(), request.body().end(), 'a');
+        });
+        double scalar_ns = MeasureNsPerCall(calls, [&]() {
+            AdaptedRequest request = adapter.RequestView();
+            buffer.assign(request.prefix());
+            std::string_view source = adaptee.SpecificRequestView();
+            buffer.append(source.rbegin(), source.rend());
+            checksum += buffer.size();
+        });
+        double simd_ns = MeasureNsPerCall(calls, [&]() {
+            buffer.clear();
+            adapter.RequestView().AppendTo(buffer);
+            checksum += buffer.size();
+        });
+        std::cout << std::setw(10) << payload << std::setw(14) << legacy_ns << std::setw(14) << view_ns
+                  << std::setw(14) << scalar_ns << std::setw(14) << simd_ns << "\n";
+    }
+    std::cout << "  (checksum " << checksum << ")\n";
+}
+
+/**
+ * 基准测试：翻译count条记录，比较逐条通过Target虚函数调用Request与一次批量翻译的吞吐量。
+ */
+void BenchmarkBatchAdapter(size_t count, size_t rounds) {
+    std::vector<Adaptee> adaptees;
+    adaptees.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        adaptees.emplace_back("record-" + std::to_string(i) + " .eetpadA eht fo roivaheb laicepS");
+    }
+    std::vector<Adapter> adapters;
+    adapters.reserve(count);
+    std::vector<std::string_view> outputs;
+    outputs.reserve(count);
+    for (Adaptee& adaptee : adaptees) {
+        adapters.emplace_back(&adaptee);
+        outputs.push_back(adaptee.SpecificRequestView());
+    }
+    size_t checksum = 0;
+    double per_call_ns = MeasureNsPerCall(rounds, [&]() {
+        for (const Adapter& adapter : adapters) {
+            const Target* target = &adapter;
+            checksum += target->Request().size();
+        }
+    });
+    TranslatedBatch batch;
+    BatchAdapter batch_adapter;
+    const BatchTarget* batch_target = &batch_adapter;
+    double batched_ns = MeasureNsPerCall(rounds, [&]() {
+        batch_target->RequestBatch(outputs.data(), outputs.size(), batch);
+        checksum += batch[batch.size() - 1].size();
+    });
+    std::cout << "Benchmark: translating " << count << " records\n";
+    std::cout << "  per-call Request: " << count / per_call_ns * 1000.0 << " Mrecords/s\n";
+    std::cout << "  batched         : " << count / batched_ns * 1000.0 << " Mrecords/s\n";
+    std::cout << "  (checksum " << checksum << ")\n";
+}
+
 int main() {
     std::cout << "Client: I can work just fine with the Target objects:\n";
     Target *target = new Target;
@@ -59,9 +313,21 @@ int main() {
     Adapter *adapter = new Adapter(adaptee);
     Client(adapter);
     std::cout << '\n';
+    std::cout << "Client: The zero-copy Adapter gives the same bytes:\n";
+    std::cout << adapter->RequestView().str() << "\n\n";
+    std::cout << "Client: And the batch Adapter translates many records at once:\n";
+    std::string_view outputs[] = {adaptee->SpecificRequestView(), ".droceR rehtonA"};
+    TranslatedBatch batch;
+    BatchAdapter().RequestBatch(outputs, 2, batch);
+    for (size_t i = 0; i < batch.size(); i++) {
+        std::cout << batch[i] << "\n";
+    }
+    std::cout << "\n";
     delete target;
     delete adaptee;
     delete adapter;
 
+    BenchmarkAdapterPayloads();
+    BenchmarkBatchAdapter(1000000, 5);
 	return 0;
 }
\ No newline at end of file
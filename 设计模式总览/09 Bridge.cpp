@@ -1,4 +1,16 @@
 #include <iostream>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <variant>
+#include <vector>
 /**
  * 实现类接口定义了所有具体实现类的通用接口。
  * 它不需要与抽象接口匹配。
@@ -9,20 +21,28 @@ class Implementation{
 public:
     virtual ~Implementation(){};
     virtual std::string OperationImplementation() const = 0;
+    // 不分配内存的版本：返回指向静态存储的视图
+    virtual std::string_view OperationImplementationView() const = 0;
 };
 
-class ConcreteImplementationA : public Implementation{
+class ConcreteImplementationA final : public Implementation{
 public:
     std::string OperationImplementation() const override{
+        return std::string(this->OperationImplementationView());
+    }
+    std::string_view OperationImplementationView() const override{
         return "ConcreteImplementationA: Here's the result on the platform A.\n";
-    } 
+    }
 };
 
-class ConcreteImplementationB : public Implementation{
+class ConcreteImplementationB final : public Implementation{
 public:
     std::string OperationImplementation() const override{
+        return std::string(this->OperationImplementationView());
+    }
+    std::string_view OperationImplementationView() const override{
         return "ConcreteImplementationB: Here's the result on the platform B.\n";
-    } 
+    }
 };
 /**
  * 抽象定义了实现层次结构的控制部分的接口。
@@ -38,6 +58,11 @@ public:
     virtual std::string Operation() const{
         return "Abstraction: Base operation with:\n" + this->implementation_->OperationImplementation();
     }
+    // 结果写入调用者提供的缓冲区
+    virtual void Operation(std::string& out) const{
+        out.assign("Abstraction: Base operation with:\n");
+        out.append(this->implementation_->OperationImplementationView());
+    }
 };
 /**
  * 你可以在不改变实现类的情况下扩展抽象。
@@ -48,12 +73,332 @@ public:
     std::string Operation() const override{
         return "ExtendedAbstraction: Extended operation with:\n" + this->implementation_->OperationImplementation(); 
     }
+    void Operation(std::string& out) const override{
+        out.assign("ExtendedAbstraction: Extended operation with:\n");
+        out.append(this->implementation_->OperationImplementationView());
+    }
+};
+
+/**
+ * 静态桥接：实现类型作为模板参数在编译期绑定，抽象直接持有实现对象。
+ * 具体实现类是final的，通过对象调用不需要虚分派，两层调用都可以被编译器内联。
+ * 代价是更换实现需要换一个类型，不能在运行时切换。
+ */
+template<typename Impl>
+class StaticAbstraction{
+protected:
+    Impl implementation_;
+public:
+    std::string Operation() const{
+        return "Abstraction: Base operation with:\n" + this->implementation_.OperationImplementation();
+    }
+    void Operation(std::string& out) const{
+        out.assign("Abstraction: Base operation with:\n");
+        out.append(this->implementation_.OperationImplementationView());
+    }
+};
+
+template<typename Impl>
+class StaticExtendedAbstraction : public StaticAbstraction<Impl>{
+public:
+    std::string Operation() const{
+        return "ExtendedAbstraction: Extended operation with:\n" + this->implementation_.OperationImplementation();
+    }
+    void Operation(std::string& out) const{
+        out.assign("ExtendedAbstraction: Extended operation with:\n");
+        out.append(this->implementation_.OperationImplementationView());
+    }
+};
+
+/**
+ * 运行时可切换的静态桥接：实现保存在std::variant中，可以随时换成另一种实现。
+ * 调用时std::visit按下标跳转到对应实现，每个分支内部仍然是可内联的非虚调用。
+ */
+using AnyImplementation = std::variant<ConcreteImplementationA, ConcreteImplementationB>;
+
+class VariantExtendedAbstraction{
+private:
+    AnyImplementation implementation_;
+public:
+    explicit VariantExtendedAbstraction(AnyImplementation implementation) : implementation_(implementation){}
+    void SetImplementation(AnyImplementation implementation){
+        this->implementation_ = implementation;
+    }
+    std::string Operation() const{
+        std::string out;
+        this->Operation(out);
+        return out;
+    }
+    void Operation(std::string& out) const{
+        out.assign("ExtendedAbstraction: Extended operation with:\n");
+        std::visit([&out](const auto& implementation){
+            out.append(implementation.OperationImplementationView());
+        }, this->implementation_);
+    }
+};
+
+/**
+ * 危险指针（Hazard Pointer）域：实现安全的延迟回收。
+ * 每个线程第一次读取时领取一个独占的危险指针槽位，线程退出时归还。
+ * 读者把正在使用的对象地址写入自己的槽位，再确认共享指针仍指向它，之后就可以放心使用；
+ * 读者只做原子读写，从不加锁，也不会被写者阻塞。
+ * 写者换下旧对象后调用Retire，只有当没有任何槽位指向它时才真正删除，否则留到下一次Retire再检查。
+ */
+class HazardPointerDomain{
+public:
+    static constexpr size_t kMaxThreads = 128;
+
+    // 线程的槽位记录在函数内的thread_local中，只对应一个域，所以整个程序只有Default这一个域
+    static HazardPointerDomain& Default(){
+        static HazardPointerDomain domain;
+        return domain;
+    }
+    HazardPointerDomain(const HazardPointerDomain&) = delete;
+    HazardPointerDomain& operator=(const HazardPointerDomain&) = delete;
+
+    // 保护shared当前指向的对象，返回值在Clear之前不会被回收
+    template<typename T>
+    T* Protect(const std::atomic<T*>& shared){
+        std::atomic<const void*>& slot = this->LocalSlot();
+        T* pointer = shared.load(std::memory_order_acquire);
+        for(;;){
+            slot.store(pointer, std::memory_order_seq_cst);
+            T* confirmed = shared.load(std::memory_order_seq_cst);
+            if(confirmed == pointer){
+                return pointer;
+            }
+            pointer = confirmed;
+        }
+    }
+    void Clear(){
+        this->LocalSlot().store(nullptr, std::memory_order_release);
+    }
+
+    template<typename T>
+    void Retire(T* pointer){
+        std::lock_guard<std::mutex> lock(retired_mutex_);
+        retired_.push_back(Retired{pointer, [](const void* p){ delete static_cast<const T*>(p); }});
+        this->Scan();
+    }
+    // 再检查一次之前因仍被保护而留下的对象
+    void Reclaim(){
+        std::lock_guard<std::mutex> lock(retired_mutex_);
+        this->Scan();
+    }
+
+    ~HazardPointerDomain(){
+        for(Retired& retired : retired_){
+            retired.deleter(retired.pointer);
+        }
+    }
+
+private:
+    HazardPointerDomain() = default;
+
+    struct alignas(64) Slot{
+        std::atomic<const void*> hazard{nullptr};
+        std::atomic<bool> owned{false};
+    };
+    struct Retired{
+        const void* pointer;
+        void (*deleter)(const void*);
+    };
+    // 线程退出时归还槽位
+    struct SlotOwner{
+        Slot* slot = nullptr;
+        ~SlotOwner(){
+            if(slot != nullptr){
+                slot->hazard.store(nullptr, std::memory_order_release);
+                slot->owned.store(false, std::memory_order_release);
+            }
+        }
+    };
+
+    std::atomic<const void*>& LocalSlot(){
+        thread_local SlotOwner owner;
+        if(owner.slot == nullptr){
+            for(Slot& slot : slots_){
+                bool expected = false;
+                if(slot.owned.compare_exchange_strong(expected, true, std::memory_order_acq_rel)){
+                    owner.slot = &slot;
+                    break;
+                }
+            }
+            if(owner.slot == nullptr){
+                throw std::runtime_error("HazardPointerDomain: too many threads");
+            }
+        }
+        return owner.slot->hazard;
+    }
+
+    // 调用者持有retired_mutex_
+    void Scan(){
+        std::vector<const void*> hazards;
+        for(Slot& slot : slots_){
+            if(const void* hazard = slot.hazard.load(std::memory_order_seq_cst)){
+                hazards.push_back(hazard);
+            }
+        }
+        std::sort(hazards.begin(), hazards.end());
+        auto still_hazardous = std::remove_if(retired_.begin(), retired_.end(), [&hazards](const Retired& retired){
+            if(std::binary_search(hazards.begin(), hazards.end(), retired.pointer)){
+                return false;
+            }
+            retired.deleter(retired.pointer);
+            return true;
+        });
+        retired_.erase(still_hazardous, retired_.end());
+    }
+
+    std::array<Slot, kMaxThreads> slots_;
+    std::mutex retired_mutex_;
+    std::vector<Retired> retired_;
+};
+
+/**
+ * 可热切换实现的抽象：实现指针是原子的，请求处理过程中可以随时切换到另一个实现。
+ * 与Abstraction不同，它拥有实现对象，被换下的实现交给危险指针域延迟删除，
+ * 因此正在使用旧实现的读者不会访问到已释放的内存。
+ * 析构时不能再有其他线程在调用Operation。
+ */
+class HotSwapAbstraction{
+private:
+    std::atomic<Implementation*> implementation_;
+    HazardPointerDomain& domain_;
+public:
+    explicit HotSwapAbstraction(Implementation* implementation)
+        : implementation_(implementation), domain_(HazardPointerDomain::Default()){}
+    HotSwapAbstraction(const HotSwapAbstraction&) = delete;
+    HotSwapAbstraction& operator=(const HotSwapAbstraction&) = delete;
+    ~HotSwapAbstraction(){
+        delete implementation_.load();
+        domain_.Reclaim();
+    }
+
+    std::string Operation() const{
+        std::string out;
+        this->Operation(out);
+        return out;
+    }
+    void Operation(std::string& out) const{
+        Implementation* implementation = domain_.Protect(implementation_);
+        out.assign("HotSwapAbstraction: Operation with:\n");
+        out.append(implementation->OperationImplementationView());
+        domain_.Clear();
+    }
+    // 切换实现并接管新实现的所有权，旧实现延迟回收。
+    // 摘下旧实现必须与Protect中发布、确认危险指针的操作处于同一个全序中，否则Scan可能看不到读者刚发布的槽位
+    void SwapImplementation(Implementation* implementation){
+        Implementation* previous = implementation_.exchange(implementation, std::memory_order_seq_cst);
+        domain_.Retire(previous);
+    }
 };
 
 void ClientCode(const Abstraction& abstraction){
     std::cout << abstraction.Operation();
 }
 
+/**
+ * 基准测试：比较虚函数桥接、模板桥接与variant桥接每次调用Operation的耗时，结果都写入同一个可复用缓冲区。
+ */
+template<typename Func>
+double MeasureNsPerCall(size_t calls, Func func){
+    auto start = std::chrono::steady_clock::now();
+    for(size_t i = 0; i < calls; i++){
+        func();
+    }
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / calls;
+}
+
+void BenchmarkBridgeForms(size_t calls){
+    ConcreteImplementationA implementation;
+    ExtendedAbstraction virtual_bridge(&implementation);
+    const Abstraction& abstraction = virtual_bridge;
+    StaticExtendedAbstraction<ConcreteImplementationA> static_bridge;
+    VariantExtendedAbstraction variant_bridge(ConcreteImplementationA{});
+    std::string out;
+    out.reserve(128);
+    size_t checksum = 0;
+    double virtual_ns = MeasureNsPerCall(calls, [&](){ abstraction.Operation(out); checksum += out.size(); });
+    double static_ns = MeasureNsPerCall(calls, [&](){ static_bridge.Operation(out); checksum += out.size(); });
+    double variant_ns = MeasureNsPerCall(calls, [&](){ variant_bridge.Operation(out); checksum += out.size(); });
+    std::cout << "Benchmark: " << calls << " Operation calls\n";
+    std::cout << "  virtual bridge : " << virtual_ns << " ns/call\n";
+    std::cout << "  template bridge: " << static_ns << " ns/call\n";
+    std::cout << "  variant bridge : " << variant_ns << " ns/call\n";
+    std::cout << "  (checksum " << checksum << ")\n";
+}
+
+/**
+ * 压力测试用的实现：记录存活实例数，并用一个魔数检测读者是否访问了已删除的对象。
+ */
+class CheckedImplementation final : public Implementation{
+private:
+    static constexpr uint32_t kAlive = 0xA11FE;
+    uint32_t canary_;
+    bool fast_;
+public:
+    static std::atomic<int> live;
+
+    explicit CheckedImplementation(bool fast) : canary_(kAlive), fast_(fast){ live.fetch_add(1); }
+    ~CheckedImplementation(){ canary_ = 0; live.fetch_sub(1); }
+    bool alive() const { return canary_ == kAlive; }
+    std::string OperationImplementation() const override{
+        return std::string(this->OperationImplementationView());
+    }
+    std::string_view OperationImplementationView() const override{
+        if(!this->alive()){
+            return "use after free";
+        }
+        return fast_ ? "fast path\n" : "fallback\n";
+    }
+};
+std::atomic<int> CheckedImplementation::live{0};
+
+/**
+ * 压力测试：readers个线程不停调用Operation，同时一个写者线程反复在快速路径与后备实现之间切换。
+ * 检查每个结果都是两种合法输出之一，结束后只剩当前实现一个存活实例。
+ */
+void StressHotSwap(unsigned readers, size_t swaps){
+    std::atomic<bool> stop{false};
+    std::atomic<size_t> reads{0};
+    std::atomic<size_t> errors{0};
+    {
+        HotSwapAbstraction abstraction(new CheckedImplementation(true));
+        std::vector<std::thread> threads;
+        for(unsigned r = 0; r < readers; r++){
+            threads.emplace_back([&](){
+                std::string out;
+                size_t local_reads = 0;
+                size_t local_errors = 0;
+                while(!stop.load(std::memory_order_relaxed)){
+                    abstraction.Operation(out);
+                    std::string_view body = std::string_view(out).substr(out.find('\n') + 1);
+                    if(body != "fast path\n" && body != "fallback\n"){
+                        local_errors++;
+                    }
+                    local_reads++;
+                }
+                reads.fetch_add(local_reads);
+                errors.fetch_add(local_errors);
+            });
+        }
+        for(size_t i = 0; i < swaps; i++){
+            abstraction.SwapImplementation(new CheckedImplementation(i % 2 == 1));
+            if(i % 64 == 0){
+                std::this_thread::yield();
+            }
+        }
+        stop.store(true);
+        for(std::thread& thread : threads){
+            thread.join();
+        }
+        std::cout << "Stress test: " << readers << " readers, " << swaps << " swaps, " << reads.load() << " reads, "
+                  << errors.load() << " bad results, " << CheckedImplementation::live.load() << " live implementation(s)\n";
+    }
+    std::cout << "  after destruction: " << CheckedImplementation::live.load() << " live implementation(s)\n";
+}
+
 int main(){
     Implementation* implementation = new ConcreteImplementationA();
     Abstraction* abstraction = new Abstraction(implementation);
@@ -68,5 +413,19 @@ int main(){
     std::cout << std::endl;
     delete implementation;
     delete abstraction;
+
+    StaticExtendedAbstraction<ConcreteImplementationA> static_abstraction;
+    std::cout << static_abstraction.Operation() << std::endl;
+    VariantExtendedAbstraction variant_abstraction(ConcreteImplementationA{});
+    variant_abstraction.SetImplementation(ConcreteImplementationB{});
+    std::cout << variant_abstraction.Operation() << std::endl;
+
+    HotSwapAbstraction hot_swap(new ConcreteImplementationA());
+    std::cout << hot_swap.Operation() << std::endl;
+    hot_swap.SwapImplementation(new ConcreteImplementationB());
+    std::cout << hot_swap.Operation() << std::endl;
+
+    BenchmarkBridgeForms(10000000);
+    StressHotSwap(std::max(2u, std::thread::hardware_concurrency()), 200000);
     return 0;
 }
\ No newline at end of file
@@ -1,55 +1,691 @@
 #include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <iterator>
 #include <list>
+#include <memory>
+#include <new>
+#include <mutex>
+#include <random>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 /**
  * 基础组件类声明了所有具体组件类的通用接口。
  * 基础组件类可以声明和实现默认行为，也可以声明接口用于访问和管理子组件。
  */
 class Component {
+    friend class Composite;
 protected:
-    Component* parent_;
+    Component* parent_ = nullptr;
+    // 侵入式兄弟链表指针，由父节点Composite维护，使删除子节点为O(1)
+    Component* prev_sibling_ = nullptr;
+    Component* next_sibling_ = nullptr;
+    // 是否有祖先缓存了结果，由SetParent维护；没有时MarkDirty不必向上走
+    bool under_cache_ = false;
+    // AddChildren检查重复节点时使用的临时标记，检查结束前总会清除
+    bool add_mark_ = false;
+
+    // 作废自己缓存的结果；返回false表示本来就已作废，此时祖先也都已作废
+    virtual bool DropCachedResult() { return true; }
+    virtual bool CachesResult() const { return false; }
+    // 组合节点改写它，把变化传给子树，遇到缓存节点或状态没变的节点即停止
+    virtual void SetUnderCache(bool under_cache) { this->under_cache_ = under_cache; }
 public:
     virtual ~Component() {}
-    void SetParent(Component* parent) { this->parent_ = parent; }
+    void SetParent(Component* parent) {
+        this->parent_ = parent;
+        this->SetUnderCache(parent != nullptr && (parent->under_cache_ || parent->CachesResult()));
+    }
     Component* GetParent() const { return this->parent_; }
+    Component* GetNextSibling() const { return this->next_sibling_; }
 
     virtual void Add(Component* component) {}
     virtual void Remove(Component* component) {}
     virtual bool IsComposite() const { return false; }
     virtual std::string Operation() const = 0;
+    // 把结果追加到out末尾，整棵树只写一个缓冲区
+    virtual void Operation(std::string& out) const { out += this->Operation(); }
+
+    // 自身结果改变后调用：沿parent_向上作废缓存，遇到已作废的祖先或上方不再有缓存时即可停止。
+    // 没有缓存节点的树里只检查自身，增删子节点仍是O(1)
+    void MarkDirty() {
+        for (Component* node = this; node != nullptr; node = node->parent_) {
+            if (!node->DropCachedResult() || !node->under_cache_) {
+                break;
+            }
+        }
+    }
 };
 // 简单子组件，一般只有最基础的操作，没有子组件
 class Leaf : public Component {
 public:
     std::string Operation() const override { return "Leaf"; }
+    void Operation(std::string& out) const override { out += "Leaf"; }
+};
+// 带有可变状态的叶子，状态改变后通知祖先作废缓存
+class LabeledLeaf : public Leaf {
+private:
+    std::string label_ = "Leaf";
+public:
+    void SetLabel(std::string label) {
+        this->label_ = std::move(label);
+        this->MarkDirty();
+    }
+    std::string Operation() const override { return this->label_; }
+    void Operation(std::string& out) const override { out += this->label_; }
 };
 // 复杂子组件，有子组件，并且可以对子组件进行操作
+// 子节点通过侵入式双向链表串起来：Add、Remove都是O(1)，不再按指针线性查找
 class Composite : public Component {
 protected:
-    std::list<Component*> children_;
+    Component* first_child_ = nullptr;
+    Component* last_child_ = nullptr;
+    size_t child_count_ = 0;
 public:
+    // 子节点的只读视图，可用于范围for循环
+    class Children {
+    public:
+        class iterator {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = Component*;
+            using difference_type = std::ptrdiff_t;
+            using pointer = Component* const*;
+            using reference = Component* const&;
+
+            explicit iterator(Component* node) : node_(node) {}
+            Component* operator*() const { return node_; }
+            iterator& operator++() { node_ = node_->GetNextSibling(); return *this; }
+            bool operator!=(const iterator& other) const { return node_ != other.node_; }
+            bool operator==(const iterator& other) const { return node_ == other.node_; }
+        private:
+            Component* node_;
+        };
+
+        explicit Children(const Composite* owner) : owner_(owner) {}
+        iterator begin() const { return iterator(owner_->first_child_); }
+        iterator end() const { return iterator(nullptr); }
+        bool empty() const { return owner_->child_count_ == 0; }
+        size_t size() const { return owner_->child_count_; }
+        Component* front() const { return owner_->first_child_; }
+        Component* back() const { return owner_->last_child_; }
+    private:
+        const Composite* owner_;
+    };
+
+    // 节点若已有父节点，先从原父节点摘下再加入，兄弟链表不会被破坏
     void Add(Component* component) override { 
-        this->children_.push_back(component); 
+        if (component->parent_ != nullptr) {
+            component->parent_->Remove(component);
+        }
+        component->prev_sibling_ = this->last_child_;
+        component->next_sibling_ = nullptr;
+        (this->last_child_ != nullptr ? this->last_child_->next_sibling_ : this->first_child_) = component;
+        this->last_child_ = component;
+        this->child_count_++;
         component->SetParent(this); 
+        this->MarkDirty();
+    }
+    // 批量添加：先把新节点串成一段链表，再一次接到末尾，只作废一次缓存。
+    // 输入有误时抛出异常且不修改任何节点
+    void AddChildren(const std::vector<Component*>& components) {
+        if (components.empty()) {
+            return;
+        }
+        // 同一个节点出现两次会让它成为自己的兄弟，在摘下或链接任何节点之前先检查
+        for (size_t i = 0; i < components.size(); i++) {
+            if (components[i]->add_mark_) {
+                for (size_t j = 0; j < i; j++) {
+                    components[j]->add_mark_ = false;
+                }
+                throw std::invalid_argument("Composite::AddChildren: duplicate component");
+            }
+            components[i]->add_mark_ = true;
+        }
+        for (Component* component : components) {
+            if (component->parent_ != nullptr) {
+                component->parent_->Remove(component);
+            }
+            component->SetParent(this);
+            component->add_mark_ = false;
+        }
+        Component* previous = this->last_child_;
+        for (Component* component : components) {
+            component->prev_sibling_ = previous;
+            if (previous != nullptr) {
+                previous->next_sibling_ = component;
+            }
+            previous = component;
+        }
+        previous->next_sibling_ = nullptr;
+        if (this->first_child_ == nullptr) {
+            this->first_child_ = components.front();
+        }
+        this->last_child_ = previous;
+        this->child_count_ += components.size();
+        this->MarkDirty();
+    }
+    void SetUnderCache(bool under_cache) override {
+        if (under_cache == this->under_cache_) {
+            return;
+        }
+        this->under_cache_ = under_cache;
+        for (Component* c = this->first_child_; c != nullptr; c = c->next_sibling_) {
+            c->SetUnderCache(under_cache || this->CachesResult());
+        }
     }
     void Remove(Component* component) override {
-        children_.remove(component);
+        if (component->parent_ != this) {
+            return;
+        }
+        (component->prev_sibling_ != nullptr ? component->prev_sibling_->next_sibling_ : this->first_child_) = component->next_sibling_;
+        (component->next_sibling_ != nullptr ? component->next_sibling_->prev_sibling_ : this->last_child_) = component->prev_sibling_;
+        component->prev_sibling_ = nullptr;
+        component->next_sibling_ = nullptr;
+        this->child_count_--;
         component->SetParent(nullptr);
+        this->MarkDirty();
     }
+    // 组合节点的输出格式，FlatTree与并行求值也使用这几个常量
+    static constexpr std::string_view kOpen = "Branch(";
+    static constexpr char kSeparator = '+';
+    static constexpr char kClose = ')';
+
     bool IsComposite() const override { return true; }
+    Children GetChildren() const { return Children(this); }
+    // 子类改写了Operation（例如改变格式或使用缓存）时应返回false，
+    // 并行求值就会整体调用它的Operation，而不是按默认格式拆开它的子节点
+    virtual bool HasDefaultOperation() const { return true; }
     std::string Operation() const override {
         std::string result;
-        for (const Component* c : children_) {
-            if (c == children_.back()) {
+        for (const Component* c = this->first_child_; c != nullptr; c = c->next_sibling_) {
+            if (c == this->last_child_) {
                 result += c->Operation();
             } else {
-                result += c->Operation() + "+";
+                result += c->Operation() + kSeparator;
             }
         } 
-        return "Branch(" + result + ")";
+        return std::string(kOpen) + result + kClose;
+    }
+    void Operation(std::string& out) const override {
+        out += kOpen;
+        for (const Component* c = this->first_child_; c != nullptr; c = c->next_sibling_) {
+            if (c != this->first_child_) {
+                out += kSeparator;
+            }
+            c->Operation(out);
+        }
+        out += kClose;
+    }
+};
+/**
+ * 缓存结果的组合节点：Operation的结果算出后保存下来，子树没有变化时直接返回缓存。
+ * 子节点的增删或状态改变会通过MarkDirty沿parent_向上作废路径上的缓存，
+ * 下一次查询只重新计算被作废的节点，未改变的子树直接拼接它们的缓存。
+ * 每一层都保存一份子树结果，内存开销约为输出长度乘以树高；缓存不是线程安全的。
+ */
+class CachingComposite : public Composite {
+private:
+    mutable std::string cache_;
+    mutable bool valid_ = false;
+
+    void Refresh() const {
+        if (!this->valid_) {
+            this->cache_.clear();
+            Composite::Operation(this->cache_);
+            this->valid_ = true;
+        }
+    }
+protected:
+    bool DropCachedResult() override {
+        bool was_valid = this->valid_;
+        this->valid_ = false;
+        return was_valid;
+    }
+    bool CachesResult() const override { return true; }
+public:
+    bool HasDefaultOperation() const override { return false; }
+    std::string Operation() const override {
+        this->Refresh();
+        return this->cache_;
+    }
+    void Operation(std::string& out) const override {
+        this->Refresh();
+        out += this->cache_;
     }
 };
 
+// 递归释放一棵由new创建的组件树
+void DestroyTree(Component* component) {
+    if (component->IsComposite()) {
+        Component* child = static_cast<Composite*>(component)->GetChildren().front();
+        while (child != nullptr) {
+            Component* next = child->GetNextSibling();
+            DestroyTree(child);
+            child = next;
+        }
+    }
+    delete component;
+}
+
+/**
+ * 组件节点池：明确节点归属，节点由池创建、由池销毁，不再需要逐个delete。
+ * 节点放在按块分配的固定大小槽位里，释放的槽位进入空闲链表重复使用。
+ * DestroySubtree一次释放整棵子树（先O(1)地从父节点摘下），池析构时销毁所有仍存活的节点。
+ * 池中的节点不能用delete或DestroyTree释放。
+ */
+class ComponentPool {
+private:
+    static constexpr size_t kSlotSize = std::max({sizeof(Leaf), sizeof(LabeledLeaf), sizeof(Composite), sizeof(CachingComposite)});
+    static constexpr size_t kSlotsPerBlock = 4096;
+
+    struct Slot {
+        alignas(std::max_align_t) unsigned char storage[kSlotSize];
+        Slot* next_free;
+        bool live;
+    };
+
+    std::vector<std::unique_ptr<Slot[]>> blocks_;
+    Slot* free_list_ = nullptr;
+    size_t live_count_ = 0;
+
+    Slot* AllocateSlot() {
+        if (this->free_list_ == nullptr) {
+            this->blocks_.emplace_back(new Slot[kSlotsPerBlock]);
+            Slot* block = this->blocks_.back().get();
+            for (size_t i = 0; i < kSlotsPerBlock; i++) {
+                block[i].live = false;
+                block[i].next_free = i + 1 < kSlotsPerBlock ? &block[i + 1] : nullptr;
+            }
+            this->free_list_ = block;
+        }
+        Slot* slot = this->free_list_;
+        this->free_list_ = slot->next_free;
+        slot->live = true;
+        this->live_count_++;
+        return slot;
+    }
+    void Destroy(Component* component) {
+        // 槽位起始地址就是最终派生对象的地址
+        Slot* slot = reinterpret_cast<Slot*>(dynamic_cast<void*>(component));
+        component->~Component();
+        slot->live = false;
+        slot->next_free = this->free_list_;
+        this->free_list_ = slot;
+        this->live_count_--;
+    }
+
+public:
+    ComponentPool() = default;
+    ComponentPool(const ComponentPool&) = delete;
+    ComponentPool& operator=(const ComponentPool&) = delete;
+    ~ComponentPool() {
+        for (std::unique_ptr<Slot[]>& block : this->blocks_) {
+            for (size_t i = 0; i < kSlotsPerBlock; i++) {
+                if (block[i].live) {
+                    reinterpret_cast<Component*>(block[i].storage)->~Component();
+                }
+            }
+        }
+    }
+
+    template<typename T, typename... Args>
+    T* Create(Args&&... args) {
+        static_assert(std::is_base_of<Component, T>::value, "ComponentPool only holds components");
+        static_assert(sizeof(T) <= kSlotSize && alignof(T) <= alignof(std::max_align_t), "component does not fit a slot");
+        return new (this->AllocateSlot()->storage) T(std::forward<Args>(args)...);
+    }
+
+    // 摘下并销毁以root为根的整棵子树
+    void DestroySubtree(Component* root) {
+        if (root->GetParent() != nullptr) {
+            root->GetParent()->Remove(root);
+        }
+        std::vector<Component*> stack{root};
+        while (!stack.empty()) {
+            Component* component = stack.back();
+            stack.pop_back();
+            if (component->IsComposite()) {
+                for (Component* child : static_cast<Composite*>(component)->GetChildren()) {
+                    stack.push_back(child);
+                }
+            }
+            this->Destroy(component);
+        }
+    }
+
+    size_t live_count() const { return this->live_count_; }
+};
+
+/**
+ * 扁平化的组件树：整棵树按前序顺序存放在连续数组里，不再每个节点单独分配。
+ * 每个节点只记录是否为组合节点，以及其子树在数组中的结束位置（后一个位置），
+ * 节点i的子树就是区间[i, subtree_end_[i])，第一个子节点是i+1，下一个兄弟是subtree_end_[i]。
+ * 叶子的输出作为负载存进去重的标签表，节点只记录标签编号，因此LabeledLeaf等叶子的内容不会丢失；
+ * 组合节点只保留结构，导出时统一成Composite。
+ * 这样Operation之类的遍历就变成对数组的一次线性扫描，没有指针跳转，也没有递归。
+ * 可以从现有的Component树构建，也可以导出回Component树。
+ */
+class FlatTree {
+private:
+    std::vector<uint8_t> is_composite_;
+    std::vector<uint32_t> subtree_end_;
+    std::vector<uint32_t> leaf_label_;  // 叶子在labels_中的编号，组合节点为0
+    std::vector<std::string> labels_{"Leaf"};
+    std::unordered_map<std::string, uint32_t> label_ids_;
+    std::vector<uint32_t> open_;  // 构建时尚未关闭的组合节点
+
+    uint32_t LabelId(std::string_view label) {
+        if (label == labels_[0]) {
+            return 0;
+        }
+        auto [it, inserted] = label_ids_.emplace(std::string(label), static_cast<uint32_t>(labels_.size()));
+        if (inserted) {
+            labels_.push_back(it->first);
+        }
+        return it->second;
+    }
+
+public:
+    void Reserve(size_t nodes) {
+        is_composite_.reserve(nodes);
+        subtree_end_.reserve(nodes);
+        leaf_label_.reserve(nodes);
+    }
+    size_t size() const { return is_composite_.size(); }
+
+    // 按前序顺序追加节点：OpenComposite与CloseComposite之间追加的节点都是它的后代
+    void AddLeaf(std::string_view label = "Leaf") {
+        is_composite_.push_back(0);
+        subtree_end_.push_back(static_cast<uint32_t>(subtree_end_.size() + 1));
+        leaf_label_.push_back(this->LabelId(label));
+    }
+    void OpenComposite() {
+        open_.push_back(static_cast<uint32_t>(is_composite_.size()));
+        is_composite_.push_back(1);
+        subtree_end_.push_back(0);
+        leaf_label_.push_back(0);
+    }
+    void CloseComposite() {
+        subtree_end_[open_.back()] = static_cast<uint32_t>(subtree_end_.size());
+        open_.pop_back();
+    }
+
+    static FlatTree FromComponent(const Component* root) {
+        FlatTree tree;
+        // 显式栈上保存（节点，是否已展开），避免深树递归
+        std::vector<std::pair<const Component*, bool>> stack{{root, false}};
+        std::string label;
+        while (!stack.empty()) {
+            auto [component, expanded] = stack.back();
+            stack.pop_back();
+            if (!component->IsComposite()) {
+                label.clear();
+                component->Operation(label);
+                tree.AddLeaf(label);
+            } else if (expanded) {
+                tree.CloseComposite();
+            } else {
+                tree.OpenComposite();
+                stack.emplace_back(component, true);
+                size_t first_child = stack.size();
+                for (const Component* child : static_cast<const Composite*>(component)->GetChildren()) {
+                    stack.emplace_back(child, false);
+                }
+                std::reverse(stack.begin() + first_child, stack.end());
+            }
+        }
+        return tree;
+    }
+
+    // 导出为新的Component树，调用者负责用DestroyTree释放
+    Component* ToComponent() const {
+        Component* root = nullptr;
+        // 尚未结束的组合节点及其子树结束位置
+        std::vector<std::pair<Component*, uint32_t>> parents;
+        for (uint32_t i = 0; i < this->size(); i++) {
+            while (!parents.empty() && parents.back().second == i) {
+                parents.pop_back();
+            }
+            Component* node;
+            if (is_composite_[i]) {
+                node = new Composite;
+            } else if (leaf_label_[i] == 0) {
+                node = new Leaf;
+            } else {
+                LabeledLeaf* leaf = new LabeledLeaf;
+                leaf->SetLabel(labels_[leaf_label_[i]]);
+                node = leaf;
+            }
+            if (parents.empty()) {
+                root = node;
+            } else {
+                parents.back().first->Add(node);
+            }
+            if (is_composite_[i]) {
+                parents.emplace_back(node, subtree_end_[i]);
+            }
+        }
+        return root;
+    }
+
+    // 与Composite::Operation结果相同，先算出长度一次分配，再顺序写入
+    std::string Operation() const {
+        std::string result;
+        size_t separators = this->size() == 0 ? 0 : this->size() - 1;
+        size_t length = 0;
+        for (size_t i = 0; i < this->size(); i++) {
+            if (!is_composite_[i]) {
+                length += labels_[leaf_label_[i]].size();
+            } else {
+                length += Composite::kOpen.size() + 1;
+                separators -= subtree_end_[i] > i + 1 ? 1 : 0;  // 第一个子节点前没有分隔符
+            }
+        }
+        result.reserve(length + separators);
+
+        std::vector<uint32_t> open;
+        bool first = true;
+        for (uint32_t i = 0; i < this->size(); i++) {
+            while (!open.empty() && open.back() == i) {
+                result += Composite::kClose;
+                open.pop_back();
+                first = false;
+            }
+            if (!first) {
+                result += Composite::kSeparator;
+            }
+            if (is_composite_[i]) {
+                result += Composite::kOpen;
+                open.push_back(subtree_end_[i]);
+                first = true;
+            } else {
+                result += labels_[leaf_label_[i]];
+                first = false;
+            }
+        }
+        result.append(open.size(), Composite::kClose);
+        return result;
+    }
+
+    size_t LeafCount() const {
+        size_t leaves = 0;
+        for (uint8_t composite : is_composite_) {
+            leaves += composite ? 0 : 1;
+        }
+        return leaves;
+    }
+};
+
+/**
+ * 并行求值Operation的工作窃取执行器。
+ * 每个工作线程有自己的任务双端队列，自己从尾部取，空闲时从其他线程的头部窃取。
+ * 任务是一棵子树，结果写进它自己的片段（Piece）；父片段只记录子片段应插入的位置，
+ * 全部完成后先算出总长度一次分配，再按顺序把各片段拼接起来，因此每个字节只复制一次。
+ * 子树是否拆成单独的任务采用惰性拆分：只有当有线程空闲且自己的队列很短时才拆，
+ * 否则直接在当前线程内顺序写入，避免为大量小子树创建任务。
+ */
+class ParallelOperationEvaluator {
+public:
+    explicit ParallelOperationEvaluator(unsigned workers) : workers_(std::max(1u, workers)) {}
+
+    std::string Evaluate(const Component* root) {
+        std::vector<Worker> workers(workers_);
+        workers_state_ = &workers;
+        Piece root_piece;
+        pending_.store(1);
+        idle_.store(workers_ - 1);  // 除了拿到根任务的0号线程，其他线程一开始都是空闲的
+        workers[0].tasks.push_back(Task{root, &root_piece});
+
+        std::vector<std::thread> threads;
+        for (unsigned w = 1; w < workers_; w++) {
+            threads.emplace_back([this, w]() { this->WorkerLoop(w); });
+        }
+        this->WorkerLoop(0);
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+        workers_state_ = nullptr;
+
+        std::string result;
+        result.reserve(root_piece.Length());
+        root_piece.AppendTo(result);
+        return result;
+    }
+
+private:
+    // 一段输出：自己的文本，加上按位置插入的子片段
+    struct Piece {
+        std::string text;
+        std::vector<std::pair<size_t, std::unique_ptr<Piece>>> inserts;
+
+        size_t Length() const {
+            size_t length = text.size();
+            for (const auto& insert : inserts) {
+                length += insert.second->Length();
+            }
+            return length;
+        }
+        void AppendTo(std::string& out) const {
+            size_t written = 0;
+            for (const auto& insert : inserts) {
+                out.append(text, written, insert.first - written);
+                insert.second->AppendTo(out);
+                written = insert.first;
+            }
+            out.append(text, written, std::string::npos);
+        }
+    };
+    struct Task {
+        const Component* component;
+        Piece* piece;
+    };
+    struct alignas(64) Worker {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void WorkerLoop(unsigned self) {
+        bool idle = self != 0;
+        while (pending_.load(std::memory_order_acquire) != 0) {
+            Task task;
+            if (this->TryTake(self, task)) {
+                if (idle) {
+                    idle_.fetch_sub(1, std::memory_order_relaxed);
+                    idle = false;
+                }
+                this->Write(task.component, *task.piece, self);
+                pending_.fetch_sub(1, std::memory_order_acq_rel);
+            } else {
+                if (!idle) {
+                    idle_.fetch_add(1, std::memory_order_relaxed);
+                    idle = true;
+                }
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    bool TryTake(unsigned self, Task& task) {
+        std::vector<Worker>& workers = *workers_state_;
+        {
+            std::lock_guard<std::mutex> lock(workers[self].mutex);
+            if (!workers[self].tasks.empty()) {
+                task = workers[self].tasks.back();
+                workers[self].tasks.pop_back();
+                return true;
+            }
+        }
+        for (unsigned offset = 1; offset < workers_; offset++) {
+            Worker& victim = workers[(self + offset) % workers_];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                task = victim.tasks.front();
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // 只有保持默认格式的组合节点才能拆开求值，其余节点一律走虚函数Operation
+    static bool IsSplittable(const Component* component) {
+        return component->IsComposite() && static_cast<const Composite*>(component)->HasDefaultOperation();
+    }
+
+    bool ShouldSplit(const Component* child, unsigned self) {
+        if (!IsSplittable(child) || idle_.load(std::memory_order_relaxed) == 0) {
+            return false;
+        }
+        Worker& worker = (*workers_state_)[self];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        return worker.tasks.size() < kMaxQueuedTasks;
+    }
+
+    // 任务本身是可拆分的组合节点时按默认格式展开一层：需要拆分的子节点交给其他线程，
+    // 其余子节点（包括不拆分的子树）直接调用它们的Operation写入当前片段
+    void Write(const Component* component, Piece& piece, unsigned self) {
+        if (!IsSplittable(component)) {
+            component->Operation(piece.text);
+            return;
+        }
+        piece.text += Composite::kOpen;
+        bool first = true;
+        for (const Component* child : static_cast<const Composite*>(component)->GetChildren()) {
+            if (!first) {
+                piece.text += Composite::kSeparator;
+            }
+            first = false;
+            if (this->ShouldSplit(child, self)) {
+                piece.inserts.emplace_back(piece.text.size(), std::make_unique<Piece>());
+                pending_.fetch_add(1, std::memory_order_relaxed);
+                Worker& worker = (*workers_state_)[self];
+                std::lock_guard<std::mutex> lock(worker.mutex);
+                worker.tasks.push_back(Task{child, piece.inserts.back().second.get()});
+            } else {
+                child->Operation(piece.text);
+            }
+        }
+        piece.text += Composite::kClose;
+    }
+
+    static constexpr size_t kMaxQueuedTasks = 2;
+    unsigned workers_;
+    std::vector<Worker>* workers_state_ = nullptr;
+    std::atomic<size_t> pending_{0};
+    std::atomic<unsigned> idle_{0};
+};
+
 void ClientCode(Component* component) {
     std::cout << "RESULT: " << component->Operation();
 }
@@ -61,6 +697,240 @@ void ClientCode2(Component* component1, Component* component2) {
     std::cout << "RESULT: " << component1->Operation();
 }
 
+// 构建每个组合节点有fanout个子节点、共depth层组合节点的完整树
+void BuildBalanced(FlatTree& tree, int fanout, int depth) {
+    if (depth == 0) {
+        tree.AddLeaf();
+        return;
+    }
+    tree.OpenComposite();
+    for (int i = 0; i < fanout; i++) {
+        BuildBalanced(tree, fanout, depth - 1);
+    }
+    tree.CloseComposite();
+}
+
+size_t CountLeaves(const Component* component) {
+    if (!component->IsComposite()) {
+        return 1;
+    }
+    size_t leaves = 0;
+    for (const Component* child : static_cast<const Composite*>(component)->GetChildren()) {
+        leaves += CountLeaves(child);
+    }
+    return leaves;
+}
+
+template<typename F>
+double MeasureMs(F&& f) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * 对比指针树与扁平树在大树上的遍历开销：统计叶子数与Operation拼接整棵树的结果。
+ */
+void BenchmarkFlatTree(int fanout, int depth) {
+    FlatTree flat;
+    BuildBalanced(flat, fanout, depth);
+    Component* tree = flat.ToComponent();
+
+    size_t pointer_leaves = 0, flat_leaves = 0;
+    std::string pointer_result, flat_result;
+    double pointer_count_ms = MeasureMs([&]() { pointer_leaves = CountLeaves(tree); });
+    double flat_count_ms = MeasureMs([&]() { flat_leaves = flat.LeafCount(); });
+    double pointer_operation_ms = MeasureMs([&]() { pointer_result = tree->Operation(); });
+    double flat_operation_ms = MeasureMs([&]() { flat_result = flat.Operation(); });
+    FlatTree rebuilt;
+    double convert_ms = MeasureMs([&]() { rebuilt = FlatTree::FromComponent(tree); });
+
+    std::cout << "Benchmark: fanout " << fanout << ", depth " << depth << ", " << flat.size() << " nodes, "
+              << flat_leaves << " leaves\n";
+    std::cout << "  leaf count : pointer tree " << pointer_count_ms << " ms, flat tree " << flat_count_ms << " ms\n";
+    std::cout << "  Operation  : pointer tree " << pointer_operation_ms << " ms, flat tree " << flat_operation_ms << " ms\n";
+    std::cout << "  FromComponent: " << convert_ms << " ms\n";
+    std::cout << "  results match: " << std::boolalpha
+              << (pointer_leaves == flat_leaves && pointer_result == flat_result && rebuilt.Operation() == flat_result) << "\n";
+    DestroyTree(tree);
+}
+
+/**
+ * 在大树上对比递归拼接、单缓冲区顺序写入与不同线程数下的并行求值，报告相对单线程的加速比。
+ */
+void BenchmarkParallelOperation(int fanout, int depth) {
+    FlatTree flat;
+    BuildBalanced(flat, fanout, depth);
+    Component* tree = flat.ToComponent();
+
+    std::string expected;
+    double recursive_ms = MeasureMs([&]() { expected = tree->Operation(); });
+    std::string appended;
+    double appended_ms = MeasureMs([&]() { tree->Operation(appended); });
+    std::cout << "Benchmark: parallel Operation, fanout " << fanout << ", depth " << depth << ", "
+              << flat.LeafCount() << " leaves\n";
+    std::cout << "  recursive concatenation: " << recursive_ms << " ms\n";
+    std::cout << "  single buffer          : " << appended_ms << " ms\n";
+
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    double baseline_ms = 0;
+    for (unsigned workers = 1; workers <= std::max(4u, cores); workers *= 2) {
+        ParallelOperationEvaluator evaluator(workers);
+        std::string result;
+        double ms = MeasureMs([&]() { result = evaluator.Evaluate(tree); });
+        if (workers == 1) {
+            baseline_ms = ms;
+        }
+        std::cout << "  work stealing, " << workers << " worker(s): " << ms << " ms, speedup "
+                  << baseline_ms / ms << "x" << (result == expected ? "" : " (MISMATCH)")
+                  << (workers > cores ? " (more workers than cores)" : "") << "\n";
+    }
+    DestroyTree(tree);
+
+}
+
+// 构建叶子为LabeledLeaf的完整树，并收集最底层的组合节点
+template<typename CompositeType>
+Component* BuildLabeledTree(int fanout, int depth, std::vector<Composite*>& bottoms) {
+    if (depth == 0) {
+        return new LabeledLeaf;
+    }
+    CompositeType* composite = new CompositeType;
+    for (int i = 0; i < fanout; i++) {
+        composite->Add(BuildLabeledTree<CompositeType>(fanout, depth - 1, bottoms));
+    }
+    if (depth == 1) {
+        bottoms.push_back(composite);
+    }
+    return composite;
+}
+
+// 对树执行随机的增删叶子、修改叶子与查询整棵树结果的混合负载，返回耗时
+template<typename CompositeType>
+double RunMixedWorkload(int fanout, int depth, size_t operations, unsigned update_percent, std::string& final_result) {
+    std::vector<Composite*> bottoms;
+    Component* root = BuildLabeledTree<CompositeType>(fanout, depth, bottoms);
+    root->Operation();
+    std::mt19937 rng(42);
+    std::string result;
+    double ms = MeasureMs([&]() {
+        for (size_t i = 0; i < operations; i++) {
+            if (rng() % 100 >= update_percent) {
+                result = root->Operation();
+                continue;
+            }
+            Composite* bottom = bottoms[rng() % bottoms.size()];
+            Composite::Children children = bottom->GetChildren();
+            switch (rng() % 3) {
+            case 0:
+                bottom->Add(new LabeledLeaf);
+                break;
+            case 1:
+                if (!children.empty()) {
+                    Component* leaf = children.back();
+                    bottom->Remove(leaf);
+                    delete leaf;
+                }
+                break;
+            default:
+                if (!children.empty()) {
+                    static_cast<LabeledLeaf*>(children.front())->SetLabel(i % 2 == 0 ? "leaf" : "Leaf");
+                }
+                break;
+            }
+        }
+    });
+    final_result = root->Operation();
+    DestroyTree(root);
+    return ms;
+}
+
+/**
+ * 并行求值遇到带缓存的组合节点时不拆开它，而是直接使用它的缓存结果。
+ */
+void CheckParallelCachedOperation(int fanout, int depth) {
+    std::vector<Composite*> bottoms;
+    Component* tree = BuildLabeledTree<CachingComposite>(fanout, depth, bottoms);
+    std::string expected = tree->Operation();
+    unsigned workers = std::max(2u, std::thread::hardware_concurrency());
+    ParallelOperationEvaluator evaluator(workers);
+    std::string result;
+    double ms = MeasureMs([&]() { result = evaluator.Evaluate(tree); });
+    std::cout << "Parallel Operation over a cached tree, " << workers << " worker(s): " << ms << " ms"
+              << (result == expected ? "" : " (MISMATCH)") << "\n";
+    DestroyTree(tree);
+}
+
+/**
+ * 在大树上按不同更新比例执行混合负载，对比每次重新计算的Composite与带缓存的CachingComposite。
+ */
+void BenchmarkCachedOperation(int fanout, int depth, size_t operations) {
+    std::cout << "Benchmark: mixed update/query workload, fanout " << fanout << ", depth " << depth << ", "
+              << operations << " operations\n";
+    for (unsigned update_percent : {1u, 10u, 50u, 90u}) {
+        std::string plain_result, cached_result;
+        double plain_ms = RunMixedWorkload<Composite>(fanout, depth, operations, update_percent, plain_result);
+        double cached_ms = RunMixedWorkload<CachingComposite>(fanout, depth, operations, update_percent, cached_result);
+        std::cout << "  " << update_percent << "% updates: recompute " << plain_ms << " ms, cached " << cached_ms
+                  << " ms" << (plain_result == cached_result ? "" : " (MISMATCH)") << "\n";
+    }
+}
+
+/**
+ * 一个节点下挂children个叶子：对比逐个new再Add、从池中创建再批量AddChildren，
+ * 按随机顺序删除全部子节点，以及整棵释放的开销。旧的std::list::remove按指针线性查找，作为对照只在较小规模上测量。
+ */
+void BenchmarkWideComposite(size_t children) {
+    std::mt19937 rng(7);
+    std::cout << "Benchmark: one composite with " << children << " children\n";
+
+    Composite* heap_root = new Composite;
+    std::vector<Component*> heap_children(children);
+    double heap_add_ms = MeasureMs([&]() {
+        for (Component*& child : heap_children) {
+            child = new Leaf;
+            heap_root->Add(child);
+        }
+    });
+    std::shuffle(heap_children.begin(), heap_children.end(), rng);
+    double remove_ms = MeasureMs([&]() {
+        for (Component* child : heap_children) {
+            heap_root->Remove(child);
+        }
+    });
+    for (Component* child : heap_children) {
+        heap_root->Add(child);
+    }
+    double destroy_ms = MeasureMs([&]() { DestroyTree(heap_root); });
+
+    ComponentPool pool;
+    Composite* pooled_root = nullptr;
+    std::vector<Component*> pooled_children(children);
+    double pooled_add_ms = MeasureMs([&]() {
+        pooled_root = pool.Create<Composite>();
+        for (Component*& child : pooled_children) {
+            child = pool.Create<Leaf>();
+        }
+        pooled_root->AddChildren(pooled_children);
+    });
+    double subtree_ms = MeasureMs([&]() { pool.DestroySubtree(pooled_root); });
+
+    std::cout << "  new + Add          : " << heap_add_ms << " ms\n";
+    std::cout << "  pool + AddChildren : " << pooled_add_ms << " ms\n";
+    std::cout << "  Remove all, O(1)   : " << remove_ms << " ms\n";
+    if (children <= 20000) {
+        std::list<Component*> list(heap_children.begin(), heap_children.end());
+        double list_ms = MeasureMs([&]() {
+            for (Component* child : heap_children) {
+                list.remove(child);
+            }
+        });
+        std::cout << "  std::list::remove  : " << list_ms << " ms\n";
+    }
+    std::cout << "  DestroyTree        : " << destroy_ms << " ms\n";
+    std::cout << "  DestroySubtree     : " << subtree_ms << " ms, " << pool.live_count() << " live nodes left\n";
+}
+
 int main() {
     Component* simple = new Leaf;
     std::cout << "Client: I've got a simple component:\n";
@@ -86,6 +956,61 @@ int main() {
     ClientCode2(tree, simple);
     std::cout << "\n"; 
 
+    LabeledLeaf* labeled = new LabeledLeaf;
+    labeled->SetLabel("Note");
+    branch2->Add(labeled);
+    FlatTree flat = FlatTree::FromComponent(tree);
+    std::cout << "Client: The same tree in flat storage keeps leaf labels:\n";
+    std::cout << "RESULT: " << tree->Operation() << "\n";
+    std::cout << "RESULT: " << flat.Operation() << "\n";
+    Component* exported = flat.ToComponent();
+    std::cout << "RESULT: " << exported->Operation() << "\n\n";
+    DestroyTree(exported);
+    branch2->Remove(labeled);
+    delete labeled;
+
+    // 把节点移到另一个父节点，以及重复添加到同一个父节点，两边的子节点链表都应保持完整
+    Composite first, second;
+    LabeledLeaf x, y, z;
+    x.SetLabel("x");
+    y.SetLabel("y");
+    z.SetLabel("z");
+    first.Add(&x);
+    first.Add(&y);
+    first.Add(&z);
+    second.Add(&y);
+    first.Add(&x);
+    std::cout << "Client: Moving children between composites keeps both intact:\n";
+    std::cout << "RESULT: " << first.Operation() << " and " << second.Operation() << " ("
+              << (first.Operation() == "Branch(z+x)" && first.GetChildren().size() == 2 &&
+                  second.Operation() == "Branch(y)" && y.GetParent() == &second ? "ok" : "BROKEN")
+              << ")\n\n";
+
+    // 批量添加遇到重复节点时抛出异常，且不修改任何节点
+    bool rejected = false;
+    try {
+        first.AddChildren({&y, &z, &y});
+    } catch (const std::invalid_argument&) {
+        rejected = true;
+    }
+    std::cout << "Client: A rejected bulk add leaves both composites unchanged:\n";
+    std::cout << "RESULT: " << first.Operation() << " and " << second.Operation() << " ("
+              << (rejected && first.Operation() == "Branch(z+x)" && second.Operation() == "Branch(y)" &&
+                  y.GetParent() == &second ? "ok" : "BROKEN")
+              << ")\n\n";
+
+    // 整棵子树接到缓存节点下方后，深处叶子的变化仍会作废上方的缓存
+    CachingComposite cached;
+    Composite middle;
+    middle.Add(&y);
+    cached.Add(&middle);
+    std::string before = cached.Operation();
+    y.SetLabel("w");
+    std::cout << "Client: Changes below a plain composite still reach the cache above it:\n";
+    std::cout << "RESULT: " << before << " -> " << cached.Operation() << " ("
+              << (before == "Branch(Branch(y))" && cached.Operation() == "Branch(Branch(w))" ? "ok" : "BROKEN")
+              << ")\n\n";
+
     delete simple;
     delete tree;
     delete branch1;
@@ -93,5 +1018,14 @@ int main() {
     delete leaf_1;
     delete leaf_2;
     delete leaf_3;
+
+    BenchmarkFlatTree(16, 5);
+    BenchmarkFlatTree(2, 21);
+    BenchmarkParallelOperation(16, 5);
+    BenchmarkParallelOperation(2, 21);
+    CheckParallelCachedOperation(8, 5);
+    BenchmarkCachedOperation(8, 5, 300);
+    BenchmarkWideComposite(20000);
+    BenchmarkWideComposite(500000);
     return 0;
 }
\ No newline at end of file
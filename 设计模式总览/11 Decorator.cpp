@@ -1,4 +1,21 @@
 #include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 /**
  * 基础组件接口定义了可以被装饰器修改的操作。
  * 具体组件、基础装饰器、具体装饰器都实现了这个接口。
@@ -7,6 +24,22 @@ class Component {
 public:
     virtual ~Component() {};
     virtual std::string Operation() const = 0;
+
+    // 融合输出：整条链都能给出结果长度时，先算出总长度，再让每一层直接写入同一个缓冲区，没有逐层的临时字符串
+    static constexpr size_t kUnknownSize = SIZE_MAX;
+    // 不提供融合输出的组件返回kUnknownSize，此时整条链退回Operation()，每个组件只求值一次
+    virtual size_t OperationSize() const { return kUnknownSize; }
+    // 从out开始写入结果，返回写入结束的位置。只在OperationSize()给出长度后调用，且恰好写入该长度
+    virtual char* WriteOperation(char* out) const { return out; }
+    virtual void Operation(std::string& out) const {
+        size_t size = this->OperationSize();
+        if (size == kUnknownSize) {
+            out = this->Operation();
+            return;
+        }
+        out.resize(size);
+        this->WriteOperation(out.data());
+    }
 };
 /**
  * 具体组件提供了操作的默认实现。这些类通常会有一个用于存储基础组件的字段。
@@ -15,9 +48,17 @@ public:
  */
 class ConcreteComponent : public Component {
 public:
+    // 改写Operation()会隐藏基类按缓冲区输出的重载，这里重新引入
+    using Component::Operation;
     std::string Operation() const override {
         return "ConcreteComponent";
     } 
+    size_t OperationSize() const override { return kResult.size(); }
+    char* WriteOperation(char* out) const override {
+        return std::copy(kResult.begin(), kResult.end(), out);
+    }
+private:
+    static constexpr std::string_view kResult = "ConcreteComponent";
 };
 /**
  * 基础装饰类遵循与其他组件相同的接口。该类的主要目的是定义所有具体装饰器的接口。
@@ -27,32 +68,382 @@ class Decorator : public Component {
 protected:
     Component* component_;
 public:
+    using Component::Operation;
     Decorator(Component* component) : component_(component) {};
     std::string Operation() const override {
         return this->component_->Operation();
     } 
+    size_t OperationSize() const override { return this->component_->OperationSize(); }
+    char* WriteOperation(char* out) const override { return this->component_->WriteOperation(out); }
+protected:
+    // 具体装饰器只需提供前缀与后缀，就能参与融合输出
+    size_t WrappedSize(std::string_view prefix, std::string_view suffix) const {
+        size_t inner = this->component_->OperationSize();
+        return inner == kUnknownSize ? kUnknownSize : prefix.size() + inner + suffix.size();
+    }
+    char* WriteWrapped(char* out, std::string_view prefix, std::string_view suffix) const {
+        out = std::copy(prefix.begin(), prefix.end(), out);
+        out = this->component_->WriteOperation(out);
+        return std::copy(suffix.begin(), suffix.end(), out);
+    }
 };
 // 具体装饰器重写了基础装饰器的方法，并在调用父方法之前或之后执行自己的行为。
 class ConcreteDecoratorA : public Decorator {
 public:
+    using Decorator::Operation;
     ConcreteDecoratorA(Component* component) : Decorator(component) {};
     std::string Operation() const override {
         return "ConcreteDecoratorA(" + Decorator::Operation() + ")";
     } 
+    size_t OperationSize() const override { return this->WrappedSize("ConcreteDecoratorA(", ")"); }
+    char* WriteOperation(char* out) const override { return this->WriteWrapped(out, "ConcreteDecoratorA(", ")"); }
 };
 
 class ConcreteDecoratorB : public Decorator {
 public:
+    using Decorator::Operation;
     ConcreteDecoratorB(Component* component) : Decorator(component) {};
     std::string Operation() const override {
         return "ConcreteDecoratorB(" + Decorator::Operation() + ")";
     } 
+    size_t OperationSize() const override { return this->WrappedSize("ConcreteDecoratorB(", ")"); }
+    char* WriteOperation(char* out) const override { return this->WriteWrapped(out, "ConcreteDecoratorB(", ")"); }
+};
+
+/**
+ * 供缓存装饰器共享的结果缓存，以被装饰的组件为键。
+ * 条目超过TTL即视为过期；总容量分到各分片，余数分给前几个分片，分片数不超过容量，
+ * 因此各分片容量之和恰好等于总容量。分片写满时按插入顺序淘汰最早的条目。
+ * 每个分片有自己的读写锁，命中只需在一个分片上加共享锁，不同组件的读者基本互不干扰。
+ * 未命中时在锁外计算结果，同一组件的并发未命中可能各算一次，以先写入者为准。
+ * 组件被释放前应调用Invalidate，避免新对象复用同一地址时读到旧结果。
+ */
+class OperationCache {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+        uint64_t expirations = 0;
+    };
+
+    OperationCache(size_t capacity, Clock::duration ttl, size_t shards = 16)
+        : ttl_(ttl), shards_(std::clamp<size_t>(shards, 1, std::max<size_t>(1, capacity))) {
+        capacity = std::max<size_t>(1, capacity);
+        for (size_t i = 0; i < shards_.size(); i++) {
+            shards_[i].capacity = capacity / shards_.size() + (i < capacity % shards_.size() ? 1 : 0);
+        }
+    }
+
+    std::shared_ptr<const std::string> GetOrCompute(const Component* key, const std::function<std::string()>& compute) {
+        Shard& shard = this->ShardFor(key);
+        Clock::time_point now = Clock::now();
+        {
+            std::shared_lock<std::shared_mutex> lock(shard.mutex);
+            auto it = shard.entries.find(key);
+            if (it != shard.entries.end() && it->second.expires > now) {
+                shard.hits.fetch_add(1, std::memory_order_relaxed);
+                return it->second.value;
+            }
+        }
+        shard.misses.fetch_add(1, std::memory_order_relaxed);
+        auto value = std::make_shared<const std::string>(compute());
+
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        now = Clock::now();
+        auto it = shard.entries.find(key);
+        if (it != shard.entries.end()) {
+            if (it->second.expires > now) {
+                return it->second.value;  // 其他线程已经写入了新结果
+            }
+            shard.expirations.fetch_add(1, std::memory_order_relaxed);
+            Erase(shard, it);
+        }
+        while (shard.entries.size() >= shard.capacity) {
+            EvictOldest(shard, now);
+        }
+        shard.insertion_order.push_back(key);
+        shard.entries.emplace(key, Entry{value, now + ttl_, std::prev(shard.insertion_order.end())});
+        return value;
+    }
+
+    void Invalidate(const Component* key) {
+        Shard& shard = this->ShardFor(key);
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        auto it = shard.entries.find(key);
+        if (it != shard.entries.end()) {
+            Erase(shard, it);
+        }
+    }
+
+    Stats GetStats() const {
+        Stats stats;
+        for (const Shard& shard : shards_) {
+            stats.hits += shard.hits.load(std::memory_order_relaxed);
+            stats.misses += shard.misses.load(std::memory_order_relaxed);
+            stats.evictions += shard.evictions.load(std::memory_order_relaxed);
+            stats.expirations += shard.expirations.load(std::memory_order_relaxed);
+        }
+        return stats;
+    }
+
+private:
+    struct Entry {
+        std::shared_ptr<const std::string> value;
+        Clock::time_point expires;
+        std::list<const Component*>::iterator order;  // 在insertion_order中的位置，与条目一起删除
+    };
+    struct alignas(64) Shard {
+        mutable std::shared_mutex mutex;
+        std::unordered_map<const Component*, Entry> entries;
+        // 当前条目的插入顺序，长度始终等于entries的大小
+        std::list<const Component*> insertion_order;
+        size_t capacity = 1;
+        std::atomic<uint64_t> hits{0};
+        std::atomic<uint64_t> misses{0};
+        std::atomic<uint64_t> evictions{0};
+        std::atomic<uint64_t> expirations{0};
+    };
+
+    Shard& ShardFor(const Component* key) {
+        // 指针的低位因对齐而相同，先打散再取模
+        uint64_t hash = static_cast<uint64_t>(reinterpret_cast<std::uintptr_t>(key)) * 0x9E3779B97F4A7C15ull;
+        return shards_[(hash >> 32) % shards_.size()];
+    }
+    // 以下两个函数的调用者持有分片的写锁
+    static void Erase(Shard& shard, std::unordered_map<const Component*, Entry>::iterator it) {
+        shard.insertion_order.erase(it->second.order);
+        shard.entries.erase(it);
+    }
+    // 分片非空时淘汰最早插入的条目
+    static void EvictOldest(Shard& shard, Clock::time_point now) {
+        auto it = shard.entries.find(shard.insertion_order.front());
+        (it->second.expires > now ? shard.evictions : shard.expirations).fetch_add(1, std::memory_order_relaxed);
+        Erase(shard, it);
+    }
+
+    Clock::duration ttl_;
+    std::vector<Shard> shards_;
+};
+
+/**
+ * 缓存装饰器：把被装饰组件的Operation结果记在共享的OperationCache里，
+ * 适合包装做I/O或大量计算的组件。它本身也是Decorator，可以与ConcreteDecoratorA/B任意叠加。
+ * 假设被装饰组件的结果在TTL内不变。
+ */
+class CachingDecorator : public Decorator {
+private:
+    OperationCache& cache_;
+
+    std::shared_ptr<const std::string> Cached() const {
+        return this->cache_.GetOrCompute(this->component_, [this]() { return Decorator::Operation(); });
+    }
+public:
+    CachingDecorator(Component* component, OperationCache& cache) : Decorator(component), cache_(cache) {}
+    std::string Operation() const override {
+        return *this->Cached();
+    }
+    // 缓存的结果可能在两次查询之间过期或被淘汰，长度与内容必须来自同一次查询，
+    // 所以不参与先求长度再写入的融合输出，外层装饰器退回Operation()，整条链仍只查一次缓存
+    size_t OperationSize() const override { return kUnknownSize; }
+    char* WriteOperation(char* out) const override { return out; }
+    void Operation(std::string& out) const override {
+        out.assign(*this->Cached());
+    }
+};
+
+/**
+ * 编译期组合的装饰器：Decorated<StaticDecoratorA, Decorated<StaticDecoratorB, ConcreteComponent>>
+ * 在类型中确定整条装饰链，内层组件按值保存，没有虚函数调用，编译器可以把整条链内联展开。
+ * Layer只需提供静态的prefix与suffix。
+ */
+struct StaticDecoratorA {
+    static constexpr std::string_view prefix = "ConcreteDecoratorA(";
+    static constexpr std::string_view suffix = ")";
+};
+struct StaticDecoratorB {
+    static constexpr std::string_view prefix = "ConcreteDecoratorB(";
+    static constexpr std::string_view suffix = ")";
+};
+
+template<typename Layer, typename Inner>
+class Decorated {
+private:
+    Inner inner_;
+public:
+    template<typename... Args>
+    explicit Decorated(Args&&... args) : inner_(std::forward<Args>(args)...) {}
+
+    size_t OperationSize() const {
+        return Layer::prefix.size() + inner_.OperationSize() + Layer::suffix.size();
+    }
+    char* WriteOperation(char* out) const {
+        out = std::copy(Layer::prefix.begin(), Layer::prefix.end(), out);
+        out = inner_.WriteOperation(out);
+        return std::copy(Layer::suffix.begin(), Layer::suffix.end(), out);
+    }
+    void Operation(std::string& out) const {
+        out.resize(this->OperationSize());
+        this->WriteOperation(out.data());
+    }
+    std::string Operation() const {
+        std::string out;
+        this->Operation(out);
+        return out;
+    }
 };
 
 void ClientCode(Component* component) {
     std::cout << "RESULT: " << component->Operation(); 
 }
 
+// 深度为Depth、A与B交替的编译期装饰链
+template<size_t Depth>
+struct StaticChain {
+    using type = Decorated<std::conditional_t<Depth % 2 == 1, StaticDecoratorA, StaticDecoratorB>,
+                           typename StaticChain<Depth - 1>::type>;
+};
+template<>
+struct StaticChain<0> {
+    using type = ConcreteComponent;
+};
+
+template<typename Func>
+double MeasureNsPerCall(size_t calls, Func func) {
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < calls; i++) {
+        func();
+    }
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / calls;
+}
+
+/**
+ * 基准测试：同一深度的装饰链分别用逐层拼接字符串、融合输出与编译期组合三种方式求值。
+ */
+template<size_t Depth>
+void BenchmarkDecoratorDepth(size_t calls) {
+    std::vector<Component*> chain{new ConcreteComponent()};
+    for (size_t i = 1; i <= Depth; i++) {
+        if (i % 2 == 1) {
+            chain.push_back(new ConcreteDecoratorA(chain.back()));
+        } else {
+            chain.push_back(new ConcreteDecoratorB(chain.back()));
+        }
+    }
+    const Component* outer = chain.back();
+    typename StaticChain<Depth>::type static_chain;
+
+    std::string nested_result, fused_result, static_result;
+    size_t checksum = 0;
+    double nested_ns = MeasureNsPerCall(calls, [&]() { nested_result = outer->Operation(); checksum += nested_result.size(); });
+    double fused_ns = MeasureNsPerCall(calls, [&]() { outer->Operation(fused_result); checksum += fused_result.size(); });
+    double static_ns = MeasureNsPerCall(calls, [&]() { static_chain.Operation(static_result); checksum += static_result.size(); });
+    std::cout << "  depth " << Depth << ": nested " << nested_ns << " ns, fused " << fused_ns << " ns, static "
+              << static_ns << " ns"
+              << (nested_result == fused_result && fused_result == static_result ? "" : " (MISMATCH)")
+              << " (checksum " << checksum << ")\n";
+    for (Component* component : chain) {
+        delete component;
+    }
+}
+
+/**
+ * 模拟开销很大的组件：每次Operation忙等一段时间，并记录被调用的次数。
+ */
+class ExpensiveComponent : public Component {
+private:
+    int id_;
+    std::chrono::microseconds cost_;
+    mutable std::atomic<size_t> calls_{0};
+public:
+    ExpensiveComponent(int id, std::chrono::microseconds cost) : id_(id), cost_(cost) {}
+    using Component::Operation;
+    std::string Operation() const override {
+        calls_.fetch_add(1, std::memory_order_relaxed);
+        auto until = std::chrono::steady_clock::now() + cost_;
+        while (std::chrono::steady_clock::now() < until) {
+        }
+        return "ExpensiveComponent" + std::to_string(id_);
+    }
+    size_t calls() const { return calls_.load(); }
+};
+
+/**
+ * 基准测试：多个线程随机查询被ConcreteDecoratorA包装的一组开销很大的组件，
+ * 对比中间插入CachingDecorator前后的吞吐，并输出命中、未命中、淘汰与过期次数。
+ * 缓存容量小于组件数，以便观察淘汰。
+ */
+void BenchmarkCachingDecorator(size_t components, size_t capacity, std::chrono::milliseconds ttl, size_t lookups_per_thread) {
+    unsigned threads = std::max(2u, std::thread::hardware_concurrency());
+    std::vector<std::unique_ptr<ExpensiveComponent>> expensive;
+    for (size_t i = 0; i < components; i++) {
+        expensive.push_back(std::make_unique<ExpensiveComponent>(static_cast<int>(i), std::chrono::microseconds(20)));
+    }
+    OperationCache cache(capacity, ttl);
+    std::vector<std::unique_ptr<Component>> caches, plain, cached;
+    for (auto& component : expensive) {
+        caches.push_back(std::make_unique<CachingDecorator>(component.get(), cache));
+        plain.push_back(std::make_unique<ConcreteDecoratorA>(component.get()));
+        cached.push_back(std::make_unique<ConcreteDecoratorA>(caches.back().get()));
+    }
+
+    auto run = [&](const std::vector<std::unique_ptr<Component>>& targets) {
+        std::atomic<size_t> bytes{0};
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> workers;
+        for (unsigned t = 0; t < threads; t++) {
+            workers.emplace_back([&, t]() {
+                std::mt19937 rng(t);
+                // 偏斜的访问分布：一半查询落在前1/8的组件上
+                std::uniform_int_distribution<size_t> hot(0, targets.size() / 8), any(0, targets.size() - 1);
+                std::string out;
+                size_t local_bytes = 0;
+                for (size_t i = 0; i < lookups_per_thread; i++) {
+                    size_t index = (i % 2 == 0) ? hot(rng) : any(rng);
+                    targets[index]->Operation(out);
+                    local_bytes += out.size();
+                }
+                bytes.fetch_add(local_bytes);
+            });
+        }
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return std::make_pair(ms, bytes.load());
+    };
+
+    auto [plain_ms, plain_bytes] = run(plain);
+    size_t plain_calls = 0;
+    for (auto& component : expensive) {
+        plain_calls += component->calls();
+    }
+    auto [cached_ms, cached_bytes] = run(cached);
+    size_t cached_calls = 0;
+    for (auto& component : expensive) {
+        cached_calls += component->calls();
+    }
+    cached_calls -= plain_calls;
+    OperationCache::Stats stats = cache.GetStats();
+
+    size_t lookups = threads * lookups_per_thread;
+    std::cout << "Benchmark: " << threads << " threads, " << lookups << " lookups over " << components
+              << " expensive components, cache capacity " << capacity << ", TTL " << ttl.count() << " ms\n";
+    std::cout << "  uncached: " << plain_ms << " ms, " << plain_calls << " expensive calls\n";
+    std::cout << "  cached  : " << cached_ms << " ms, " << cached_calls << " expensive calls"
+              << (plain_bytes == cached_bytes ? "" : " (MISMATCH)") << "\n";
+    std::cout << "  hits " << stats.hits << ", misses " << stats.misses << ", evictions " << stats.evictions
+              << ", expirations " << stats.expirations << "\n";
+}
+
+template<size_t... Depths>
+void BenchmarkDecoratorChains(size_t calls, std::index_sequence<Depths...>) {
+    std::cout << "Benchmark: " << calls << " Operation calls per decorator chain depth\n";
+    (BenchmarkDecoratorDepth<Depths>(calls), ...);
+}
+
 int main() {
     Component* simple = new ConcreteComponent();
     std::cout << "Client: I've got a simple component:\n";
@@ -64,6 +455,29 @@ int main() {
     std::cout << "Client: Now I've got a decorated component:\n";
     ClientCode(decorator2);
     std::cout << "\n";
+
+    std::string fused;
+    decorator2->Operation(fused);
+    std::cout << "Client: The fused decorator chain writes the same result into one buffer:\n";
+    std::cout << "RESULT: " << fused << "\n";
+    Decorated<StaticDecoratorB, Decorated<StaticDecoratorA, ConcreteComponent>> composed;
+    std::cout << "Client: And so does the chain composed at compile time:\n";
+    std::cout << "RESULT: " << composed.Operation() << "\n\n";
+
+    ExpensiveComponent expensive(0, std::chrono::microseconds(100));
+    OperationCache cache(64, std::chrono::seconds(1));
+    CachingDecorator caching(&expensive, cache);
+    ConcreteDecoratorB stacked(&caching);
+    std::cout << "Client: A caching decorator stacks with the other decorators:\n";
+    ClientCode(&stacked);
+    std::cout << "\n";
+    ClientCode(&stacked);
+    OperationCache::Stats stats = cache.GetStats();
+    std::cout << "\n(expensive calls " << expensive.calls() << ", hits " << stats.hits << ", misses " << stats.misses << ")\n\n";
+
+    BenchmarkDecoratorChains(200000, std::index_sequence<1, 2, 4, 8, 16, 32, 64>{});
+    BenchmarkCachingDecorator(256, 128, std::chrono::milliseconds(50), 10000);
+    BenchmarkCachingDecorator(256, 512, std::chrono::milliseconds(1), 10000);
     delete simple;
     delete decorator1;
     delete decorator2;